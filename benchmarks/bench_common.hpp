@@ -0,0 +1,275 @@
+#ifndef BENCHMARKS_BENCH_COMMON_HPP
+
+    #define BENCHMARKS_BENCH_COMMON_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/TSXGuard.hpp"
+
+// Shared helpers for the benchmark executables:
+// command line parsing, a cheap per-thread PRNG,
+// a thread launcher with a common start line and
+// the synchronization policies under comparison.
+namespace bench {
+    static constexpr int CACHE_LINE = 64;
+
+    // Options parses arguments of the form --key=value.
+    // A bare --key is stored with the value "1".
+    class Options {
+    private:
+        std::map<std::string, std::string> values;
+    public:
+        Options(int argc, char **argv) {
+            for (int i = 1; i < argc; i++) {
+                std::string arg(argv[i]);
+                if (arg.compare(0, 2, "--") != 0) {
+                    std::cerr << "Ignoring argument: " << arg << std::endl;
+                    continue;
+                }
+                std::size_t eq = arg.find('=');
+                if (eq == std::string::npos) {
+                    values[arg.substr(2)] = "1";
+                } else {
+                    values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+                }
+            }
+        }
+
+        bool has(const std::string &key) const {
+            return values.find(key) != values.end();
+        }
+
+        std::string getString(const std::string &key, const std::string &def) const {
+            auto it = values.find(key);
+            return it == values.end() ? def : it->second;
+        }
+
+        long getInt(const std::string &key, long def) const {
+            auto it = values.find(key);
+            return it == values.end() ? def : std::strtol(it->second.c_str(), nullptr, 0);
+        }
+
+        double getDouble(const std::string &key, double def) const {
+            auto it = values.find(key);
+            return it == values.end() ? def : std::strtod(it->second.c_str(), nullptr);
+        }
+
+        // comma separated list, e.g. --threads=1,2,4
+        std::vector<std::string> getList(const std::string &key, const std::string &def) const {
+            std::vector<std::string> list;
+            std::stringstream ss(getString(key, def));
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (!item.empty()) list.push_back(item);
+            }
+            return list;
+        }
+
+        std::vector<long> getIntList(const std::string &key, const std::string &def) const {
+            std::vector<long> list;
+            for (const std::string &item : getList(key, def)) {
+                list.push_back(std::strtol(item.c_str(), nullptr, 0));
+            }
+            return list;
+        }
+    };
+
+    // xorshift64*, good enough for workload generation
+    // and cheap enough to not show up in the measurements
+    class XorShift {
+    private:
+        uint64_t state;
+    public:
+        explicit XorShift(uint64_t seed): state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+        uint64_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        // uniform in [0, n)
+        uint64_t below(uint64_t n) {
+            return n == 0 ? 0 : next() % n;
+        }
+
+        // uniform in [0, 1)
+        double uniform() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    inline double seconds_between(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    // run_threads: starts nthreads workers calling work(tid)
+    // and releases them together so that thread creation
+    // is not part of the measured interval.
+    // Returns the wall time from release until the last join.
+    template <class Work>
+    double run_threads(int nthreads, Work work) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < nthreads; t++) {
+            threads.push_back(std::thread([&, t]() {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) _mm_pause();
+                work(t);
+            }));
+        }
+
+        while (ready.load() != nthreads) std::this_thread::yield();
+        Clock::time_point start = Clock::now();
+        go.store(true, std::memory_order_release);
+
+        for (auto &th : threads) th.join();
+
+        return seconds_between(start, Clock::now());
+    }
+
+    // Barrier: reusable spinning barrier for phased workloads
+    class Barrier {
+    private:
+        const int nthreads;
+        std::atomic<int> arrived;
+        std::atomic<int> generation;
+    public:
+        explicit Barrier(int n): nthreads(n), arrived(0), generation(0) {}
+
+        void wait() {
+            int gen = generation.load(std::memory_order_acquire);
+            if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == nthreads) {
+                arrived.store(0, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_release);
+            } else {
+                while (generation.load(std::memory_order_acquire) == gen) std::this_thread::yield();
+            }
+        }
+    };
+
+    // Synchronization policies. Each one runs a callable
+    // as a critical section: critical(fn, stats).
+    // Only GuardWithStatsSync fills in the statistics.
+    struct GuardSync {
+        TSX::SpinLock lock;
+        const int retries;
+
+        explicit GuardSync(int max_retries): retries(max_retries) {}
+
+        static const char *name() { return "TSXGuard"; }
+        static bool has_stats() { return false; }
+
+        template <class F>
+        void critical(F &&fn, TSX::TSXStats &) {
+            unsigned char status = 0;
+            TSX::TSXGuard guard(retries, lock, status);
+            fn();
+        }
+    };
+
+    struct GuardWithStatsSync {
+        TSX::SpinLock lock;
+        const int retries;
+
+        explicit GuardWithStatsSync(int max_retries): retries(max_retries) {}
+
+        static const char *name() { return "TSXGuardWithStats"; }
+        static bool has_stats() { return true; }
+
+        template <class F>
+        void critical(F &&fn, TSX::TSXStats &stats) {
+            unsigned char status = 0;
+            TSX::TSXGuardWithStats guard(retries, lock, status, stats);
+            fn();
+        }
+    };
+
+    struct SpinLockSync {
+        TSX::SpinLock lock;
+
+        explicit SpinLockSync(int) {}
+
+        static const char *name() { return "SpinLock"; }
+        static bool has_stats() { return false; }
+
+        template <class F>
+        void critical(F &&fn, TSX::TSXStats &) {
+            lock.lock();
+            fn();
+            lock.unlock();
+        }
+    };
+
+    // no synchronization at all, for single threaded baselines
+    struct SequentialSync {
+        explicit SequentialSync(int) {}
+
+        static const char *name() { return "sequential"; }
+        static bool has_stats() { return false; }
+
+        template <class F>
+        void critical(F &&fn, TSX::TSXStats &) {
+            fn();
+        }
+    };
+
+    struct MutexSync {
+        std::mutex lock;
+
+        explicit MutexSync(int) {}
+
+        static const char *name() { return "std::mutex"; }
+        static bool has_stats() { return false; }
+
+        template <class F>
+        void critical(F &&fn, TSX::TSXStats &) {
+            std::lock_guard<std::mutex> guard(lock);
+            fn();
+        }
+    };
+
+    // CSV columns for TSXStats, empty when the policy
+    // does not collect statistics
+    inline const char *stats_csv_header() {
+        return "tx_starts,tx_commits,tx_aborts,conflict_aborts,capacity_aborts,"
+               "explicit_aborts,lock_taken_aborts,other_aborts,lock_acquisitions";
+    }
+
+    inline std::string stats_csv(const TSX::TSXStats &stats, bool valid) {
+        if (!valid) return ",,,,,,,,";
+
+        std::stringstream ss;
+        ss << stats.tx_starts << ',' << stats.tx_commits << ',' << stats.tx_aborts << ','
+           << stats.tx_aborts_per_reason[TSX::TX_ABORT_CONFLICT] << ','
+           << stats.tx_aborts_per_reason[TSX::TX_ABORT_CAPACITY] << ','
+           << stats.tx_aborts_per_reason[TSX::TX_ABORT_EXPLICIT] << ','
+           << stats.tx_aborts_per_reason[TSX::TX_ABORT_LOCK_TAKEN] << ','
+           << stats.tx_aborts_per_reason[TSX::TX_ABORT_REST] << ','
+           << stats.tx_lacqs;
+        return ss.str();
+    }
+
+    // keeps results alive so the optimizer cannot drop the work
+    inline void consume(uint64_t value) {
+        static std::atomic<uint64_t> sink(0);
+        sink.fetch_add(value, std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,359 @@
+// TSX::BPlusTree against a B+tree with latch crabbing.
+//
+// Usage: ./bplustree_bench [--threads=1,2,4,8] [--trees=tsx,latch]
+//                          [--keys=1048576] [--find-pct=60] [--insert-pct=15]
+//                          [--range-pct=10] [--range-length=16] [--fanout=N]
+//                          [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Keys are drawn uniformly from [0, --keys), half of them are inserted
+// before the run, erases take the share left after finds, range scans
+// and inserts. --fanout defaults to TSX::BPlusTree::default_fanout(),
+// the baseline uses the same fanout.
+
+#include <pthread.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXBPlusTree.hpp"
+
+// B+tree with a reader-writer latch per node. Readers couple read
+// latches down the tree. Inserts couple write latches and release all
+// the ancestors once a node has room, so a split only touches latches
+// already held. Erases write latch only the leaf and never merge,
+// like most latch coupled trees in practice.
+class LatchCrabbingTree {
+private:
+    struct Node {
+        pthread_rwlock_t latch;
+        int count;
+        bool leaf;
+        Node *next;
+        long *keys;         // fanout + 1, room for one overflowing entry
+        long *values;       // leaves, fanout + 1
+        Node **children;    // internal nodes, fanout + 2
+    };
+
+    pthread_rwlock_t root_latch;
+    Node *root;
+    const int fanout;
+
+    Node *make_node(bool leaf) {
+        Node *n = new Node;
+        pthread_rwlock_init(&n->latch, nullptr);
+        n->count = 0;
+        n->leaf = leaf;
+        n->next = nullptr;
+        n->keys = new long[fanout + 1];
+        n->values = leaf ? new long[fanout + 1] : nullptr;
+        n->children = leaf ? nullptr : new Node *[fanout + 2];
+        return n;
+    }
+
+    void free_subtree(Node *n) {
+        if (!n->leaf) {
+            for (int i = 0; i <= n->count; i++) free_subtree(n->children[i]);
+        }
+        pthread_rwlock_destroy(&n->latch);
+        delete[] n->keys;
+        delete[] n->values;
+        delete[] n->children;
+        delete n;
+    }
+
+    static int lower_bound(const Node *n, long key) {
+        int lo = 0, hi = n->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (n->keys[mid] < key) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    static int child_index(const Node *n, long key) {
+        int lo = 0, hi = n->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (key < n->keys[mid]) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
+    }
+
+    // insert_into: may leave the node one entry over fanout
+    static void insert_into(Node *n, int pos, long key, long value, Node *right) {
+        std::memmove(n->keys + pos + 1, n->keys + pos, (n->count - pos) * sizeof(long));
+        n->keys[pos] = key;
+        if (n->leaf) {
+            std::memmove(n->values + pos + 1, n->values + pos, (n->count - pos) * sizeof(long));
+            n->values[pos] = value;
+        } else {
+            std::memmove(n->children + pos + 2, n->children + pos + 1, (n->count - pos) * sizeof(Node *));
+            n->children[pos + 1] = right;
+        }
+        n->count++;
+    }
+
+    // split: moves the upper half of an overflowing node into a new one
+    Node *split(Node *n, long &separator) {
+        Node *right = make_node(n->leaf);
+        int mid = n->count / 2;
+        if (n->leaf) {
+            right->count = n->count - mid;
+            std::memcpy(right->keys, n->keys + mid, right->count * sizeof(long));
+            std::memcpy(right->values, n->values + mid, right->count * sizeof(long));
+            right->next = n->next;
+            n->next = right;
+            separator = right->keys[0];
+        } else {
+            separator = n->keys[mid];
+            right->count = n->count - mid - 1;
+            std::memcpy(right->keys, n->keys + mid + 1, right->count * sizeof(long));
+            std::memcpy(right->children, n->children + mid + 1, (right->count + 1) * sizeof(Node *));
+        }
+        n->count = mid;
+        return right;
+    }
+
+    static void lock_for_update(Node *n) {
+        if (n->leaf) pthread_rwlock_wrlock(&n->latch);
+        else pthread_rwlock_rdlock(&n->latch);
+    }
+
+public:
+    LatchCrabbingTree(int node_fanout, int): fanout(node_fanout) {
+        pthread_rwlock_init(&root_latch, nullptr);
+        root = make_node(true);
+    }
+
+    ~LatchCrabbingTree() {
+        free_subtree(root);
+        pthread_rwlock_destroy(&root_latch);
+    }
+
+    static const char *name() { return "latch crabbing"; }
+
+    bool find(long key, long &value) {
+        pthread_rwlock_rdlock(&root_latch);
+        Node *n = root;
+        pthread_rwlock_rdlock(&n->latch);
+        pthread_rwlock_unlock(&root_latch);
+        while (!n->leaf) {
+            Node *child = n->children[child_index(n, key)];
+            pthread_rwlock_rdlock(&child->latch);
+            pthread_rwlock_unlock(&n->latch);
+            n = child;
+        }
+        int pos = lower_bound(n, key);
+        bool found = pos < n->count && n->keys[pos] == key;
+        if (found) value = n->values[pos];
+        pthread_rwlock_unlock(&n->latch);
+        return found;
+    }
+
+    template <class F>
+    std::size_t range(long lo, long hi, F fn) {
+        pthread_rwlock_rdlock(&root_latch);
+        Node *n = root;
+        pthread_rwlock_rdlock(&n->latch);
+        pthread_rwlock_unlock(&root_latch);
+        while (!n->leaf) {
+            Node *child = n->children[child_index(n, lo)];
+            pthread_rwlock_rdlock(&child->latch);
+            pthread_rwlock_unlock(&n->latch);
+            n = child;
+        }
+        std::size_t visited = 0;
+        for (int pos = lower_bound(n, lo); ; pos = 0) {
+            for (; pos < n->count; pos++) {
+                if (n->keys[pos] > hi) {
+                    pthread_rwlock_unlock(&n->latch);
+                    return visited;
+                }
+                fn(n->keys[pos], n->values[pos]);
+                visited++;
+            }
+            // left to right latch order, no deadlock with splits
+            Node *next = n->next;
+            if (next) pthread_rwlock_rdlock(&next->latch);
+            pthread_rwlock_unlock(&n->latch);
+            if (!next) return visited;
+            n = next;
+        }
+    }
+
+    bool insert(long key, long value) {
+        // held[0] is the topmost node still latched, it is either
+        // the root (with root_latch held) or a node with room
+        std::vector<Node *> held;
+        held.reserve(16);
+        bool root_held = true;
+        pthread_rwlock_wrlock(&root_latch);
+        Node *n = root;
+        pthread_rwlock_wrlock(&n->latch);
+        held.push_back(n);
+        if (n->count < fanout) {
+            pthread_rwlock_unlock(&root_latch);
+            root_held = false;
+        }
+
+        while (!n->leaf) {
+            Node *child = n->children[child_index(n, key)];
+            pthread_rwlock_wrlock(&child->latch);
+            if (child->count < fanout) {
+                if (root_held) pthread_rwlock_unlock(&root_latch);
+                root_held = false;
+                for (Node *h : held) pthread_rwlock_unlock(&h->latch);
+                held.clear();
+            }
+            held.push_back(child);
+            n = child;
+        }
+
+        int pos = lower_bound(n, key);
+        bool inserted = !(pos < n->count && n->keys[pos] == key);
+        if (inserted) {
+            insert_into(n, pos, key, value, nullptr);
+            // split bottom up through the latched ancestors
+            for (int level = static_cast<int>(held.size()) - 1;
+                 level >= 0 && held[level]->count > fanout; level--) {
+                long separator = 0;
+                Node *right = split(held[level], separator);
+                if (level > 0) {
+                    Node *parent = held[level - 1];
+                    insert_into(parent, child_index(parent, separator), separator, 0, right);
+                } else {
+                    Node *new_root = make_node(false);
+                    new_root->count = 1;
+                    new_root->keys[0] = separator;
+                    new_root->children[0] = held[0];
+                    new_root->children[1] = right;
+                    root = new_root;
+                }
+            }
+        }
+
+        for (Node *h : held) pthread_rwlock_unlock(&h->latch);
+        if (root_held) pthread_rwlock_unlock(&root_latch);
+        return inserted;
+    }
+
+    bool erase(long key) {
+        pthread_rwlock_rdlock(&root_latch);
+        Node *n = root;
+        lock_for_update(n);
+        pthread_rwlock_unlock(&root_latch);
+        while (!n->leaf) {
+            Node *child = n->children[child_index(n, key)];
+            lock_for_update(child);
+            pthread_rwlock_unlock(&n->latch);
+            n = child;
+        }
+        int pos = lower_bound(n, key);
+        bool erased = pos < n->count && n->keys[pos] == key;
+        if (erased) {
+            std::memmove(n->keys + pos, n->keys + pos + 1, (n->count - pos - 1) * sizeof(long));
+            std::memmove(n->values + pos, n->values + pos + 1, (n->count - pos - 1) * sizeof(long));
+            n->count--;
+        }
+        pthread_rwlock_unlock(&n->latch);
+        return erased;
+    }
+};
+
+class TSXTree {
+private:
+    TSX::BPlusTree<long, long> tree;
+public:
+    TSXTree(int fanout, int retries): tree(fanout, retries) {}
+
+    static const char *name() { return "TSX::BPlusTree"; }
+
+    bool find(long key, long &value) { return tree.find(key, value); }
+    template <class F>
+    std::size_t range(long lo, long hi, F fn) { return tree.range(lo, hi, fn); }
+    bool insert(long key, long value) { return tree.insert(key, value); }
+    bool erase(long key) { return tree.erase(key); }
+};
+
+template <class Tree>
+void run(const bench::Options &opts, int nthreads, int fanout, int retries) {
+    const long keys = opts.getInt("keys", 1 << 20);
+    const int find_pct = opts.getInt("find-pct", 60);
+    const int insert_pct = opts.getInt("insert-pct", 15);
+    const int range_pct = opts.getInt("range-pct", 10);
+    const long range_length = opts.getInt("range-length", 16);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    Tree tree(fanout, retries);
+    for (long k = 0; k < keys; k += 2) tree.insert(k, k);
+
+    std::vector<uint64_t> ops(nthreads, 0);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        uint64_t n = 0;
+        long sum = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            long key = rng.below(keys);
+            int r = rng.below(100);
+            if (r < find_pct) {
+                long value = 0;
+                if (tree.find(key, value)) sum += value;
+            } else if (r < find_pct + range_pct) {
+                sum += tree.range(key, key + range_length, [](long, long) {});
+            } else if (r < find_pct + range_pct + insert_pct) {
+                tree.insert(key, key);
+            } else {
+                tree.erase(key);
+            }
+            n++;
+        }
+        ops[tid] = n;
+        bench::consume(sum);
+    });
+
+    timer.join();
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+
+    std::cout << Tree::name() << ',' << nthreads << ',' << fanout << ',' << keys << ','
+              << find_pct << ',' << insert_pct << ',' << range_pct << ',' << elapsed << ','
+              << total << ',' << static_cast<uint64_t>(total / elapsed) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+    int fanout = opts.getInt("fanout", TSX::BPlusTree<long, long>::default_fanout());
+
+    if (!opts.has("no-header")) {
+        std::cout << "tree,threads,fanout,keys,find_pct,insert_pct,range_pct,seconds,ops,ops_per_sec"
+                  << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4,8")) {
+        for (const std::string &tree : opts.getList("trees", "tsx,latch")) {
+            if (tree == "tsx") {
+                run<TSXTree>(opts, nthreads, fanout, retries);
+            } else if (tree == "latch") {
+                run<LatchCrabbingTree>(opts, nthreads, fanout, retries);
+            } else {
+                std::cerr << "Unknown tree: " << tree << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Transactional capacity and duration probe.
+//
+// Usage: ./capacity_probe [--max-lines=16384] [--strides=64,4096] [--trials=200]
+//                         [--max-cycles-log2=24] [--threshold=0.5]
+//                         [--cpu=N] [--noise-cpu=M] [--noise-kb=1024]
+//                         [--profile=tsx_profile.txt] [--no-header]
+//
+// Runs raw _xbegin/_xend transactions that
+//  * read or write an increasing number of cache lines with a given stride
+//    (the stride exposes cache associativity: a 4096 byte stride maps
+//    every line to the same L1 set),
+//  * spin for an increasing number of TSC cycles on a single line,
+// and prints the abort rate of every point as CSV.
+//
+// With --noise-cpu a second thread streams over its own buffer
+// on the given CPU, pick the SMT sibling of --cpu to measure
+// the capacity left while the sibling is busy.
+//
+// The largest footprints and duration that stay below --threshold
+// abort rate are written to the machine profile that TSX::machine_profile()
+// loads through the TSX_PROFILE environment variable.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXProfile.hpp"
+
+enum Mode { READ, WRITE };
+
+struct Point {
+    long trials;
+    long commits;
+    long aborts_per_reason[TSX::TX_ABORT_REASONS_END];
+
+    Point(): trials(0), commits(0) {
+        for (int i = 0; i < TSX::TX_ABORT_REASONS_END; i++) aborts_per_reason[i] = 0;
+    }
+
+    double abort_rate() const {
+        return trials == 0 ? 1.0 : 1.0 - static_cast<double>(commits) / trials;
+    }
+
+    void record(unsigned int status) {
+        trials++;
+        if (status == _XBEGIN_STARTED) {
+            commits++;
+        } else if (status & _XABORT_CAPACITY) {
+            aborts_per_reason[TSX::TX_ABORT_CAPACITY]++;
+        } else if (status & _XABORT_CONFLICT) {
+            aborts_per_reason[TSX::TX_ABORT_CONFLICT]++;
+        } else if (status & _XABORT_EXPLICIT) {
+            aborts_per_reason[TSX::TX_ABORT_EXPLICIT]++;
+        } else {
+            aborts_per_reason[TSX::TX_ABORT_REST]++;
+        }
+    }
+};
+
+static bool pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// one transaction touching nlines lines, stride bytes apart
+static unsigned int footprint_tx(volatile char *buf, long nlines, long stride, Mode mode) {
+    unsigned int status = _xbegin();
+    if (status == _XBEGIN_STARTED) {
+        if (mode == WRITE) {
+            for (long i = 0; i < nlines; i++) buf[i * stride]++;
+        } else {
+            char sum = 0;
+            for (long i = 0; i < nlines; i++) sum += buf[i * stride];
+            (void) sum;
+        }
+        _xend();
+    }
+    return status;
+}
+
+// one transaction spinning for cycles TSC cycles
+static unsigned int duration_tx(volatile long *line, unsigned long long cycles) {
+    unsigned int status = _xbegin();
+    if (status == _XBEGIN_STARTED) {
+        unsigned long long start = __builtin_ia32_rdtsc();
+        while (__builtin_ia32_rdtsc() - start < cycles) (*line)++;
+        _xend();
+    }
+    return status;
+}
+
+static void print_row(const char *sweep, const char *mode, long stride, long size, const Point &p) {
+    std::cout << sweep << ',' << mode << ',' << stride << ',' << size << ','
+              << p.trials << ',' << p.commits << ',' << p.abort_rate() << ','
+              << p.aborts_per_reason[TSX::TX_ABORT_CONFLICT] << ','
+              << p.aborts_per_reason[TSX::TX_ABORT_CAPACITY] << ','
+              << p.aborts_per_reason[TSX::TX_ABORT_EXPLICIT] << ','
+              << p.aborts_per_reason[TSX::TX_ABORT_REST] << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+
+    long max_lines = opts.getInt("max-lines", 16384);
+    std::vector<long> strides = opts.getIntList("strides", "64,4096");
+    long trials = opts.getInt("trials", 200);
+    int max_cycles_log2 = opts.getInt("max-cycles-log2", 24);
+    double threshold = opts.getDouble("threshold", 0.5);
+    std::string profile_path = opts.getString("profile", "tsx_profile.txt");
+
+    if (opts.has("cpu") && !pin_to_cpu(opts.getInt("cpu", 0))) {
+        std::cerr << "Could not pin probe to cpu " << opts.getInt("cpu", 0) << std::endl;
+    }
+
+    // background load on another (ideally the SMT sibling) cpu
+    std::atomic<bool> stop_noise(false);
+    std::thread noise;
+    if (opts.has("noise-cpu")) {
+        int noise_cpu = opts.getInt("noise-cpu", 1);
+        long noise_bytes = opts.getInt("noise-kb", 1024) * 1024;
+        noise = std::thread([&stop_noise, noise_cpu, noise_bytes]() {
+            pin_to_cpu(noise_cpu);
+            std::vector<char> scratch(noise_bytes);
+            while (!stop_noise.load(std::memory_order_relaxed)) {
+                for (long i = 0; i < noise_bytes; i += bench::CACHE_LINE) scratch[i]++;
+            }
+            bench::consume(scratch[0]);
+        });
+    }
+
+    // the profile capacities come from the cache line stride sweep
+    bool has_line_stride = false;
+    for (long s : strides) has_line_stride = has_line_stride || s == bench::CACHE_LINE;
+    if (!has_line_stride) strides.insert(strides.begin(), bench::CACHE_LINE);
+
+    long max_stride = 0;
+    for (long s : strides) max_stride = s > max_stride ? s : max_stride;
+
+    void *mem = nullptr;
+    if (posix_memalign(&mem, 4096, max_lines * max_stride) != 0) {
+        std::cerr << "Could not allocate " << max_lines * max_stride << " bytes" << std::endl;
+        return 1;
+    }
+    volatile char *buf = static_cast<volatile char *>(mem);
+    std::memset(mem, 0, max_lines * max_stride);
+
+    if (!opts.has("no-header")) {
+        std::cout << "sweep,mode,stride,size,trials,commits,abort_rate,"
+                  << "conflict_aborts,capacity_aborts,explicit_aborts,other_aborts" << std::endl;
+    }
+
+    TSX::MachineProfile profile;
+    profile.read_capacity = 0;
+    profile.write_capacity = 0;
+    profile.max_cycles = 0;
+
+    // footprint sweep
+    for (long stride : strides) {
+        for (int m = READ; m <= WRITE; m++) {
+            Mode mode = static_cast<Mode>(m);
+            bool fits = true;
+
+            for (long nlines = 1; nlines <= max_lines; nlines *= 2) {
+                Point p;
+                for (long t = 0; t < trials; t++) {
+                    // warm up: no cold misses or page faults in the transaction
+                    for (long i = 0; i < nlines; i++) buf[i * stride]++;
+                    p.record(footprint_tx(buf, nlines, stride, mode));
+                }
+                print_row("footprint", mode == READ ? "read" : "write", stride, nlines, p);
+
+                fits = fits && p.abort_rate() < threshold;
+                if (fits && stride == bench::CACHE_LINE) {
+                    if (mode == READ) profile.read_capacity = nlines;
+                    else profile.write_capacity = nlines;
+                }
+            }
+        }
+    }
+
+    // duration sweep
+    alignas(bench::CACHE_LINE) volatile long line = 0;
+    bool fits = true;
+    for (int k = 8; k <= max_cycles_log2; k++) {
+        unsigned long long cycles = 1ull << k;
+        Point p;
+        for (long t = 0; t < trials; t++) {
+            p.record(duration_tx(&line, cycles));
+        }
+        print_row("duration", "spin", 0, cycles, p);
+
+        fits = fits && p.abort_rate() < threshold;
+        if (fits) profile.max_cycles = cycles;
+    }
+
+    stop_noise.store(true);
+    if (noise.joinable()) noise.join();
+    std::free(mem);
+
+    // if even a single line transaction does not commit
+    // retrying is pointless, go to the lock right away
+    profile.rtm_usable = profile.read_capacity > 0 && profile.write_capacity > 0;
+    profile.max_retries = profile.rtm_usable ? TSX::MachineProfile().max_retries : 1;
+
+    if (!profile.save(profile_path)) {
+        std::cerr << "Could not write profile to " << profile_path << std::endl;
+        return 1;
+    }
+    std::cerr << "Wrote machine profile to " << profile_path << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Throughput of tiny guarded updates, one transaction each or coalesced.
+//
+// Usage: ./coalesce_bench [--threads=1,4] [--counters=4096] [--sections=256]
+//                         [--impls=guard,coalesce] [--max-width=32]
+//                         [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Every request runs --sections back to back sections, each adding one to
+// a random counter of a shared table of --counters longs, either
+//   guard:     in one TSXGuard per section
+//   coalesce:  through a per-thread TSX::Coalescer of at most --max-width
+// final_width is the mean width the coalescers settled at (1 for guard).
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXCoalesce.hpp"
+#include "../include/TSXProfile.hpp"
+
+void run(const bench::Options &opts, const std::string &impl, int nthreads, int retries) {
+    const long counters = opts.getInt("counters", 4096);
+    const long sections = opts.getInt("sections", 256);
+    const long max_width = opts.getInt("max-width", TSX::Coalescer::DEFAULT_MAX_WIDTH);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    std::vector<long> table(counters, 0);
+    std::vector<uint64_t> ops(nthreads, 0);
+    std::vector<int> widths(nthreads, 1);
+    TSX::SpinLock lock;
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        std::vector<long> picked(sections);
+        TSX::Coalescer batch(lock, max_width, retries);
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (long i = 0; i < sections; i++) picked[i] = rng.below(counters);
+            if (impl == "coalesce") {
+                batch.run(sections, [&](std::size_t i) { table[picked[i]]++; });
+            } else {
+                for (long i = 0; i < sections; i++) {
+                    unsigned char status = 0;
+                    TSX::TSXGuard guard(retries, lock, status);
+                    table[picked[i]]++;
+                }
+            }
+            n += sections;
+        }
+        ops[tid] = n;
+        if (impl == "coalesce") widths[tid] = batch.width();
+    });
+
+    timer.join();
+
+    uint64_t total = 0, sum = 0;
+    for (uint64_t n : ops) total += n;
+    for (long n : table) sum += n;
+    double width = 0;
+    for (int w : widths) width += w;
+
+    std::cout << impl << ',' << nthreads << ',' << counters << ',' << sections << ',' << elapsed << ','
+              << total << ',' << static_cast<uint64_t>(total / elapsed) << ','
+              << width / nthreads << ',' << (sum == total ? "ok" : "FAILED") << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    const int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "impl,threads,counters,sections,seconds,ops,ops_per_sec,final_width,valid" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,4")) {
+        for (const std::string &impl : opts.getList("impls", "guard,coalesce")) {
+            if (impl != "guard" && impl != "coalesce") {
+                std::cerr << "Unknown implementation: " << impl << std::endl;
+                return 1;
+            }
+            run(opts, impl, nthreads, retries);
+        }
+    }
+
+    return 0;
+}
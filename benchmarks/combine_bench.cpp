@@ -0,0 +1,92 @@
+// Throughput of a section that always falls back, run through the
+// fall-back lock of TSXGuard or combined by a TSX::Combiner.
+//
+// Usage: ./combine_bench [--threads=1,4] [--push-pct=50]
+//                        [--impls=guard,combine]
+//                        [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Every operation pushes to or pops from one shared std::deque. Pushes
+// allocate, which aborts the transactions, so the workload measures
+// the fall-back path:
+//   guard:    one TSXGuard per operation, queueing on the SpinLock
+//   combine:  Combiner::execute, batched by whichever thread combines
+
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXCombine.hpp"
+#include "../include/TSXProfile.hpp"
+
+void run(const bench::Options &opts, const std::string &impl, int nthreads, int retries) {
+    const long push_pct = opts.getInt("push-pct", 50);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    std::deque<long> queue;
+    std::vector<uint64_t> ops(nthreads, 0);
+    TSX::SpinLock lock;
+    TSX::Combiner *combiner = new TSX::Combiner(lock, retries);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        uint64_t n = 0, popped = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            const bool push = static_cast<long>(rng.below(100)) < push_pct;
+            auto op = [&queue, &popped, push, n]() {
+                if (push) {
+                    queue.push_back(n);
+                } else if (!queue.empty()) {
+                    popped += queue.front();
+                    queue.pop_front();
+                }
+            };
+            if (impl == "combine") {
+                combiner->execute(op);
+            } else {
+                unsigned char status = 0;
+                TSX::TSXGuard guard(retries, lock, status);
+                op();
+            }
+            n++;
+        }
+        ops[tid] = n;
+        bench::consume(popped);
+    });
+
+    timer.join();
+    delete combiner;
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+
+    std::cout << impl << ',' << nthreads << ',' << push_pct << ',' << elapsed << ','
+              << total << ',' << static_cast<uint64_t>(total / elapsed) << ',' << queue.size() << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    const int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "impl,threads,push_pct,seconds,ops,ops_per_sec,final_size" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,4")) {
+        for (const std::string &impl : opts.getList("impls", "guard,combine")) {
+            if (impl != "guard" && impl != "combine") {
+                std::cerr << "Unknown implementation: " << impl << std::endl;
+                return 1;
+            }
+            run(opts, impl, nthreads, retries);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+// TSX::HashMap against a striped mutex hash map.
+//
+// Usage: ./hashmap_bench [--threads=1,2,4,8,16,32,64] [--maps=tsx,striped]
+//                        [--keys=1048576] [--find-pct=80] [--insert-pct=10]
+//                        [--stripes=64] [--duration-ms=1000] [--retries=N]
+//                        [--no-header]
+//
+// Keys are drawn uniformly from [0, --keys), half of them are
+// inserted before the run. The remaining operations after finds and
+// inserts are erases, so the defaults keep the size roughly stable.
+// --retries defaults to the machine profile (TSX_PROFILE).
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXHashMap.hpp"
+
+// the baseline: one std::unordered_map and mutex per stripe
+class StripedMap {
+private:
+    struct alignas(bench::CACHE_LINE) Stripe {
+        std::mutex lock;
+        std::unordered_map<long, long> map;
+    };
+
+    std::vector<Stripe> stripes;
+
+    Stripe &stripe(long key) {
+        return stripes[static_cast<uint64_t>(key * 0x9E3779B97F4A7C15ull) % stripes.size()];
+    }
+
+public:
+    StripedMap(std::size_t, int nstripes): stripes(nstripes) {}
+
+    static const char *name() { return "striped_mutex"; }
+
+    bool find(long key, long &value) {
+        Stripe &s = stripe(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        auto it = s.map.find(key);
+        if (it == s.map.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    bool insert(long key, long value) {
+        Stripe &s = stripe(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.map.insert(std::make_pair(key, value)).second;
+    }
+
+    bool erase(long key) {
+        Stripe &s = stripe(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.map.erase(key) != 0;
+    }
+};
+
+class TSXMap {
+private:
+    TSX::HashMap<long, long> map;
+public:
+    TSXMap(std::size_t capacity, int retries): map(capacity, retries) {}
+
+    static const char *name() { return "TSX::HashMap"; }
+
+    bool find(long key, long &value) { return map.find(key, value); }
+    bool insert(long key, long value) { return map.insert(key, value); }
+    bool erase(long key) { return map.erase(key); }
+};
+
+template <class Map>
+void run(const bench::Options &opts, int nthreads, int param) {
+    const long keys = opts.getInt("keys", 1 << 20);
+    const int find_pct = opts.getInt("find-pct", 80);
+    const int insert_pct = opts.getInt("insert-pct", 10);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    Map map(keys / 2, param);
+    for (long k = 0; k < keys; k += 2) map.insert(k, k);
+
+    std::vector<uint64_t> ops(nthreads, 0);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        uint64_t n = 0;
+        long sum = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            long key = rng.below(keys);
+            int r = rng.below(100);
+            if (r < find_pct) {
+                long value = 0;
+                if (map.find(key, value)) sum += value;
+            } else if (r < find_pct + insert_pct) {
+                map.insert(key, key);
+            } else {
+                map.erase(key);
+            }
+            n++;
+        }
+        ops[tid] = n;
+        bench::consume(sum);
+    });
+
+    timer.join();
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+
+    std::cout << Map::name() << ',' << nthreads << ',' << keys << ',' << find_pct << ','
+              << insert_pct << ',' << elapsed << ',' << total << ','
+              << static_cast<uint64_t>(total / elapsed) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+    int stripes = opts.getInt("stripes", 64);
+
+    if (!opts.has("no-header")) {
+        std::cout << "map,threads,keys,find_pct,insert_pct,seconds,ops,ops_per_sec" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4,8,16,32,64")) {
+        for (const std::string &map : opts.getList("maps", "tsx,striped")) {
+            if (map == "tsx") {
+                run<TSXMap>(opts, nthreads, retries);
+            } else if (map == "striped") {
+                run<StripedMap>(opts, nthreads, stripes);
+            } else {
+                std::cerr << "Unknown map: " << map << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef BENCHMARKS_HISTOGRAM_HPP
+
+    #define BENCHMARKS_HISTOGRAM_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+    // Histogram is a fixed precision, log-linear
+    // histogram in the style of HdrHistogram.
+    // Values below 2^SUB_BUCKET_BITS are recorded exactly,
+    // larger values with a relative error below
+    // 2^-(SUB_BUCKET_BITS - 1), i.e. under 1.6%.
+    // Recording is a couple of shifts and one increment,
+    // so it can be done on the measured path.
+    class Histogram {
+    private:
+        static constexpr int SUB_BUCKET_BITS = 7;
+        static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+        static constexpr uint64_t HALF = SUB_BUCKETS / 2;
+
+        std::vector<uint64_t> counts;
+        uint64_t total;
+        uint64_t max_value;
+        double sum;
+
+        static int msb(uint64_t value) {
+            return 63 - __builtin_clzll(value);
+        }
+
+        static std::size_t index_of(uint64_t value) {
+            if (value < SUB_BUCKETS) return value;
+            int shift = msb(value) - SUB_BUCKET_BITS + 1;
+            uint64_t sub = value >> shift;     // in [HALF, SUB_BUCKETS)
+            return SUB_BUCKETS + (shift - 1) * HALF + (sub - HALF);
+        }
+
+        // highest value that maps to index
+        static uint64_t value_of(std::size_t index) {
+            if (index < SUB_BUCKETS) return index;
+            uint64_t k = index - SUB_BUCKETS;
+            int shift = k / HALF + 1;
+            uint64_t sub = k % HALF + HALF;
+            return ((sub + 1) << shift) - 1;
+        }
+
+    public:
+        Histogram():
+        counts(SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * HALF, 0),
+        total(0),
+        max_value(0),
+        sum(0)
+        {}
+
+        void record(uint64_t value) {
+            counts[index_of(value)]++;
+            total++;
+            sum += value;
+            if (value > max_value) max_value = value;
+        }
+
+        void merge(const Histogram &other) {
+            for (std::size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+            total += other.total;
+            sum += other.sum;
+            if (other.max_value > max_value) max_value = other.max_value;
+        }
+
+        uint64_t count() const { return total; }
+        uint64_t max() const { return max_value; }
+        double mean() const { return total == 0 ? 0 : sum / total; }
+
+        // percentile: value at or below which
+        // percent of the recorded values fall
+        uint64_t percentile(double percent) const {
+            if (total == 0) return 0;
+
+            uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+            if (rank < 1) rank = 1;
+            if (rank > total) rank = total;
+
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < counts.size(); i++) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    uint64_t value = value_of(i);
+                    return value < max_value ? value : max_value;
+                }
+            }
+
+            return max_value;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,113 @@
+// Latency of TSX::kcas against the software k-CAS alone.
+//
+// Usage: ./kcas_bench [--threads=1,2,4,8] [--k=1,2,4,8] [--words=1024]
+//                     [--impls=kcas,software] [--duration-ms=1000]
+//                     [--retries=N] [--no-header]
+//
+// Every thread reads k distinct random words out of --words and tries to
+// add 4 to all of them with one k-CAS. Latency (nanoseconds) covers the
+// reads and the k-CAS, successful or not; success_rate shows how often
+// the words changed in between.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "histogram.hpp"
+#include "../include/TSXKCAS.hpp"
+
+static inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench::Clock::now().time_since_epoch()).count();
+}
+
+template <bool SOFTWARE>
+void run(const bench::Options &opts, int nthreads, int k, int retries) {
+    const long nwords = opts.getInt("words", 1024);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    std::vector<TSX::KCASWord> words(nwords);
+    for (TSX::KCASWord &w : words) w.store(0);
+
+    std::vector<bench::Histogram> latency(nthreads);
+    std::vector<uint64_t> successes(nthreads, 0);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        TSX::KCASWord *addrs[TSX::KCAS_MAX_WORDS];
+        uintptr_t expected[TSX::KCAS_MAX_WORDS], desired[TSX::KCAS_MAX_WORDS];
+        uint64_t ok = 0;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < k; i++) {
+                bool duplicate;
+                do {
+                    addrs[i] = &words[rng.below(nwords)];
+                    duplicate = false;
+                    for (int j = 0; j < i; j++) duplicate |= addrs[j] == addrs[i];
+                } while (duplicate);
+            }
+
+            uint64_t start = now_ns();
+            for (int i = 0; i < k; i++) {
+                expected[i] = TSX::kcas_read(*addrs[i]);
+                desired[i] = expected[i] + 4;
+            }
+            bool success = SOFTWARE ? TSX::kcas_software(k, addrs, expected, desired)
+                                    : TSX::kcas(k, addrs, expected, desired, retries);
+            latency[tid].record(now_ns() - start);
+            ok += success;
+        }
+        successes[tid] = ok;
+    });
+
+    timer.join();
+
+    bench::Histogram all;
+    uint64_t total_ok = 0;
+    for (int i = 0; i < nthreads; i++) {
+        all.merge(latency[i]);
+        total_ok += successes[i];
+    }
+
+    std::cout << (SOFTWARE ? "software" : "kcas") << ',' << nthreads << ',' << k << ',' << nwords << ','
+              << elapsed << ',' << all.count() << ',' << static_cast<double>(total_ok) / all.count() << ','
+              << all.mean() << ',' << all.percentile(50) << ',' << all.percentile(99) << ','
+              << all.max() << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "impl,threads,k,words,seconds,ops,success_rate,mean_ns,p50_ns,p99_ns,max_ns" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4,8")) {
+        for (long k : opts.getIntList("k", "1,2,4,8")) {
+            if (k < 1 || k > TSX::KCAS_MAX_WORDS) {
+                std::cerr << "k must be between 1 and " << TSX::KCAS_MAX_WORDS << std::endl;
+                return 1;
+            }
+            for (const std::string &impl : opts.getList("impls", "kcas,software")) {
+                if (impl == "kcas") {
+                    run<false>(opts, nthreads, k, retries);
+                } else if (impl == "software") {
+                    run<true>(opts, nthreads, k, retries);
+                } else {
+                    std::cerr << "Unknown implementation: " << impl << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
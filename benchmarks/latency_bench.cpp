@@ -0,0 +1,159 @@
+// Open-loop latency benchmark.
+//
+// Usage: ./latency_bench [--threads=4] [--rates=100000,200000,400000,800000]
+//                        [--sync=guard,spinlock] [--set-size=4] [--slots=4096]
+//                        [--cs-length=0] [--duration-ms=1000] [--retries=20]
+//                        [--poisson] [--no-header]
+//
+// Every thread issues critical sections on a fixed schedule, so that
+// together they offer --rates operations per second (evenly spaced, or
+// exponentially spaced with --poisson). Latency is measured from the
+// time an operation was scheduled to start, not from the time it actually
+// started, so a thread that falls behind (waiting on the fall-back lock,
+// retrying, or stuck behind a slow previous operation) accounts for the
+// queueing it causes instead of hiding it (coordinated omission).
+// Service time, measured from the actual start, is reported next to it.
+// All times are in nanoseconds, one CSV row per (sync, rate) pair.
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "histogram.hpp"
+
+struct alignas(bench::CACHE_LINE) Slot {
+    volatile uint64_t value;
+};
+
+struct Workload {
+    int nthreads;
+    int set_size;
+    long slots;
+    long cs_length;
+    long duration_ms;
+    bool poisson;
+};
+
+static inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench::Clock::now().time_since_epoch()).count();
+}
+
+template <class Sync>
+void run(const Workload &w, double rate, int retries) {
+    Sync sync(retries);
+    std::vector<Slot> data(w.slots);
+    for (auto &slot : data) slot.value = 0;
+
+    std::vector<bench::Histogram> latency(w.nthreads), service(w.nthreads);
+    std::vector<TSX::TSXStats> stats(w.nthreads);
+
+    // every thread offers rate / nthreads operations per second
+    const double interval_ns = 1e9 * w.nthreads / rate;
+    const uint64_t start = now_ns() + 1000000;     // common schedule origin
+    const uint64_t end = start + w.duration_ms * 1000000ull;
+
+    double elapsed = bench::run_threads(w.nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        std::vector<long> idx(w.set_size);
+        uint64_t sum = 0;
+
+        // stagger the threads inside one interval
+        double scheduled = start + interval_ns * tid / w.nthreads;
+
+        while (scheduled < end) {
+            uint64_t intended = static_cast<uint64_t>(scheduled);
+
+            for (int i = 0; i < w.set_size; i++) idx[i] = rng.below(w.slots);
+
+            // wait for the scheduled start, yielding while far from it
+            uint64_t t = now_ns();
+            while (t < intended) {
+                if (intended - t > 20000) std::this_thread::yield();
+                else _mm_pause();
+                t = now_ns();
+            }
+
+            uint64_t actual = t;
+            sync.critical([&]() {
+                for (int i = 0; i < w.set_size; i++) data[idx[i]].value++;
+                for (long k = 0; k < w.cs_length; k++) sum = sum * 31 + k;
+            }, stats[tid]);
+            uint64_t done = now_ns();
+
+            latency[tid].record(done - intended);
+            service[tid].record(done - actual);
+
+            scheduled += w.poisson ? -std::log(1.0 - rng.uniform()) * interval_ns : interval_ns;
+        }
+
+        bench::consume(sum);
+    });
+
+    bench::Histogram total_latency, total_service;
+    for (int t = 0; t < w.nthreads; t++) {
+        total_latency.merge(latency[t]);
+        total_service.merge(service[t]);
+    }
+
+    std::cout << Sync::name() << ',' << w.nthreads << ',' << static_cast<uint64_t>(rate) << ','
+              << static_cast<uint64_t>(total_latency.count() / elapsed) << ','
+              << total_latency.count() << ','
+              << total_latency.percentile(50) << ',' << total_latency.percentile(90) << ','
+              << total_latency.percentile(99) << ',' << total_latency.percentile(99.9) << ','
+              << total_latency.percentile(99.99) << ',' << total_latency.max() << ','
+              << static_cast<uint64_t>(total_latency.mean()) << ','
+              << total_service.percentile(50) << ',' << total_service.percentile(99) << ','
+              << total_service.percentile(99.9) << ','
+              << bench::stats_csv(TSX::total_stats(stats), Sync::has_stats()) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+
+    Workload w;
+    w.nthreads = opts.getInt("threads", 4);
+    w.set_size = opts.getInt("set-size", 4);
+    w.slots = opts.getInt("slots", 4096);
+    w.cs_length = opts.getInt("cs-length", 0);
+    w.duration_ms = opts.getInt("duration-ms", 1000);
+    w.poisson = opts.has("poisson");
+    int retries = opts.getInt("retries", 20);
+
+    if (w.nthreads < 1 || w.set_size < 1 || w.slots < 1) {
+        std::cerr << "--threads, --set-size and --slots must be positive" << std::endl;
+        return 1;
+    }
+
+    if (!opts.has("no-header")) {
+        std::cout << "sync,threads,offered_ops_per_sec,achieved_ops_per_sec,ops,"
+                  << "p50,p90,p99,p999,p9999,max,mean,"
+                  << "service_p50,service_p99,service_p999,"
+                  << bench::stats_csv_header() << std::endl;
+    }
+
+    for (long rate : opts.getIntList("rates", "100000,200000,400000,800000")) {
+        if (rate <= 0) {
+            std::cerr << "Ignoring non positive rate " << rate << std::endl;
+            continue;
+        }
+        for (const std::string &sync : opts.getList("sync", "guard,spinlock")) {
+            if (sync == "guard") {
+                run<bench::GuardSync>(w, rate, retries);
+            } else if (sync == "guard_stats") {
+                run<bench::GuardWithStatsSync>(w, rate, retries);
+            } else if (sync == "spinlock") {
+                run<bench::SpinLockSync>(w, rate, retries);
+            } else if (sync == "mutex") {
+                run<bench::MutexSync>(w, rate, retries);
+            } else {
+                std::cerr << "Unknown sync method: " << sync << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
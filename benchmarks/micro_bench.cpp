@@ -0,0 +1,132 @@
+// Microbenchmark comparing TSXGuard, TSXGuardWithStats,
+// SpinLock and std::mutex on a parameterized workload.
+//
+// Usage: ./micro_bench [--threads=1,2,4] [--sync=guard,guard_stats,spinlock,mutex]
+//                      [--set-size=4] [--write-ratio=0.5] [--private]
+//                      [--cs-length=0] [--slots=4096] [--duration-ms=1000]
+//                      [--retries=20] [--no-header]
+//
+// Each operation touches --set-size cache lines (slots), picked at random
+// from a shared array (or a per-thread array with --private), writes them
+// with probability --write-ratio, reads them otherwise and then spins for
+// --cs-length iterations inside the critical section.
+// One CSV row is printed per (sync, threads) pair.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+
+struct alignas(bench::CACHE_LINE) Slot {
+    volatile uint64_t value;
+};
+
+struct Workload {
+    int set_size;
+    double write_ratio;
+    bool shared;
+    long cs_length;
+    long slots;
+    long duration_ms;
+};
+
+template <class Sync>
+void run(const Workload &w, int nthreads, int retries) {
+    Sync sync(retries);
+    std::vector<TSX::TSXStats> stats(nthreads);
+    std::vector<uint64_t> ops(nthreads, 0);
+
+    long total_slots = w.shared ? w.slots : w.slots * nthreads;
+    std::vector<Slot> data(total_slots);
+    for (auto &slot : data) slot.value = 0;
+
+    std::atomic<bool> stop(false);
+
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(w.duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        Slot *region = w.shared ? &data[0] : &data[tid * w.slots];
+        std::vector<long> idx(w.set_size);
+        uint64_t local_ops = 0, sum = 0;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            // pick the footprint outside the critical section
+            for (int i = 0; i < w.set_size; i++) idx[i] = rng.below(w.slots);
+            bool write = rng.uniform() < w.write_ratio;
+
+            sync.critical([&]() {
+                if (write) {
+                    for (int i = 0; i < w.set_size; i++) region[idx[i]].value++;
+                } else {
+                    for (int i = 0; i < w.set_size; i++) sum += region[idx[i]].value;
+                }
+                for (long k = 0; k < w.cs_length; k++) {
+                    sum = sum * 31 + k;
+                }
+            }, stats[tid]);
+
+            local_ops++;
+        }
+
+        ops[tid] = local_ops;
+        bench::consume(sum);
+    });
+
+    timer.join();
+
+    uint64_t total_ops = 0;
+    for (uint64_t n : ops) total_ops += n;
+
+    std::cout << Sync::name() << ',' << nthreads << ',' << w.set_size << ','
+              << w.write_ratio << ',' << (w.shared ? "shared" : "private") << ','
+              << w.cs_length << ',' << elapsed << ',' << total_ops << ','
+              << static_cast<uint64_t>(total_ops / elapsed) << ','
+              << bench::stats_csv(TSX::total_stats(stats), Sync::has_stats()) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+
+    Workload w;
+    w.set_size = opts.getInt("set-size", 4);
+    w.write_ratio = opts.getDouble("write-ratio", 0.5);
+    w.shared = !opts.has("private");
+    w.cs_length = opts.getInt("cs-length", 0);
+    w.slots = opts.getInt("slots", 4096);
+    w.duration_ms = opts.getInt("duration-ms", 1000);
+    int retries = opts.getInt("retries", 20);
+
+    if (w.set_size < 1 || w.slots < 1) {
+        std::cerr << "--set-size and --slots must be positive" << std::endl;
+        return 1;
+    }
+
+    if (!opts.has("no-header")) {
+        std::cout << "sync,threads,set_size,write_ratio,data,cs_length,seconds,ops,ops_per_sec,"
+                  << bench::stats_csv_header() << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4")) {
+        for (const std::string &sync : opts.getList("sync", "guard,guard_stats,spinlock,mutex")) {
+            if (sync == "guard") {
+                run<bench::GuardSync>(w, nthreads, retries);
+            } else if (sync == "guard_stats") {
+                run<bench::GuardWithStatsSync>(w, nthreads, retries);
+            } else if (sync == "spinlock") {
+                run<bench::SpinLockSync>(w, nthreads, retries);
+            } else if (sync == "mutex") {
+                run<bench::MutexSync>(w, nthreads, retries);
+            } else {
+                std::cerr << "Unknown sync method: " << sync << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Abort rates of TSX::OrderedMap by tree size.
+//
+// Usage: ./orderedmap_bench [--sizes=1024,16384,262144,1048576,4194304]
+//                           [--threads=4] [--find-pct=80] [--insert-pct=10]
+//                           [--range-pct=0] [--range-length=16]
+//                           [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// For every size the tree is filled with that many keys out of
+// [0, 2 * size) and then hit with a mix of finds, inserts, erases and
+// short range queries, all under TSXGuardWithStats. Erases take
+// the remaining share, with equal insert and erase shares the size
+// stays roughly constant during a run.
+// Capacity aborts start to show once the path from the root no longer
+// fits the transactional read set, conflict aborts grow with the
+// number of threads updating the top of the tree.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXOrderedMap.hpp"
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    const int find_pct = opts.getInt("find-pct", 80);
+    const int insert_pct = opts.getInt("insert-pct", 10);
+    const int range_pct = opts.getInt("range-pct", 0);
+    const long range_length = opts.getInt("range-length", 16);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+    const int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "size,threads,seconds,ops,ops_per_sec,aborts_per_op,fallbacks_per_op,"
+                  << bench::stats_csv_header() << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "4")) {
+        for (long size : opts.getIntList("sizes", "1024,16384,262144,1048576,4194304")) {
+            const long keys = 2 * size;
+            TSX::OrderedMap<long, long> map(retries);
+
+            // shuffled inserts, so the fill does not degrade to the worst case
+            bench::XorShift fill(size);
+            for (long inserted = 0; inserted < size; ) {
+                if (map.insert(fill.below(keys), 0)) inserted++;
+            }
+
+            std::vector<TSX::TSXStats> stats(nthreads);
+            std::vector<uint64_t> ops(nthreads, 0);
+            std::atomic<bool> stop(false);
+            std::thread timer([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+                stop.store(true, std::memory_order_relaxed);
+            });
+
+            double elapsed = bench::run_threads(nthreads, [&](int tid) {
+                bench::XorShift rng(tid + 1);
+                TSX::TSXStats *s = &stats[tid];
+                uint64_t n = 0;
+                long sum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    long key = rng.below(keys);
+                    int r = rng.below(100);
+                    if (r < find_pct) {
+                        long value = 0;
+                        if (map.find(key, value, s)) sum += value;
+                    } else if (r < find_pct + range_pct) {
+                        sum += map.range(key, key + range_length, [](long, long) {}, s);
+                    } else if (r < find_pct + range_pct + insert_pct) {
+                        map.insert(key, key, s);
+                    } else {
+                        map.erase(key, s);
+                    }
+                    n++;
+                }
+                ops[tid] = n;
+                bench::consume(sum);
+            });
+
+            timer.join();
+
+            uint64_t total = 0;
+            for (uint64_t n : ops) total += n;
+            TSX::TSXStats all = TSX::total_stats(stats);
+
+            std::cout << size << ',' << nthreads << ',' << elapsed << ',' << total << ','
+                      << static_cast<uint64_t>(total / elapsed) << ','
+                      << static_cast<double>(all.tx_aborts) / total << ','
+                      << static_cast<double>(all.tx_lacqs) / total << ','
+                      << bench::stats_csv(all, true) << std::endl;
+        }
+    }
+
+    return 0;
+}
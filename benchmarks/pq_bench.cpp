@@ -0,0 +1,146 @@
+// TSX::PriorityQueue against a single binary heap behind one lock.
+//
+// Usage: ./pq_bench [--threads=1,2,4,8,16,32,64] [--queues=tsx,guard,mutex]
+//                   [--insert-pct=50] [--prefill=65536] [--heaps-per-thread=2]
+//                   [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Every thread pushes (--insert-pct percent of its operations) and pops
+// random keys on a queue prefilled with --prefill entries. The TSX::PriorityQueue
+// gets --heaps-per-thread heaps per thread. The baselines are one
+// std::priority_queue under TSXGuard (guard) or std::mutex (mutex).
+
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXPriorityQueue.hpp"
+
+class TSXQueue {
+private:
+    TSX::PriorityQueue<long, long> queue;
+public:
+    TSXQueue(int heaps, long, int retries): queue(heaps, 1024, retries) {}
+
+    static const char *name() { return "TSX::PriorityQueue"; }
+
+    void push(long key) { queue.push(key, key); }
+    bool pop(long &key) {
+        long value;
+        return queue.pop(key, value);
+    }
+};
+
+// std::priority_queue with a container reserved up front,
+// so pushes do not allocate inside a transaction
+template <class Sync>
+class LockedHeap {
+private:
+    typedef std::pair<long, long> Entry;
+    typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > Heap;
+
+    static Heap reserved(long capacity) {
+        std::vector<Entry> storage;
+        storage.reserve(capacity);
+        return Heap(std::greater<Entry>(), std::move(storage));
+    }
+
+    Sync sync;
+    Heap heap;
+    TSX::TSXStats unused;
+
+public:
+    LockedHeap(int, long prefill, int retries): sync(retries), heap(reserved(4 * prefill + 1024)) {}
+
+    static std::string name() { return std::string("heap/") + Sync::name(); }
+
+    void push(long key) {
+        sync.critical([&]() { heap.push(Entry(key, key)); }, unused);
+    }
+
+    bool pop(long &key) {
+        bool found = false;
+        sync.critical([&]() {
+            found = !heap.empty();
+            if (found) {
+                key = heap.top().first;
+                heap.pop();
+            }
+        }, unused);
+        return found;
+    }
+};
+
+template <class Queue>
+void run(const bench::Options &opts, int nthreads, int retries) {
+    const int insert_pct = opts.getInt("insert-pct", 50);
+    const long prefill = opts.getInt("prefill", 1 << 16);
+    const int heaps = nthreads * opts.getInt("heaps-per-thread", 2);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    Queue queue(heaps, prefill, retries);
+    bench::XorShift fill(1);
+    for (long i = 0; i < prefill; i++) queue.push(fill.next() >> 2);
+
+    std::vector<uint64_t> ops(nthreads, 0);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        uint64_t n = 0;
+        long sum = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (static_cast<int>(rng.below(100)) < insert_pct) {
+                queue.push(rng.next() >> 2);
+            } else {
+                long key = 0;
+                if (queue.pop(key)) sum += key;
+            }
+            n++;
+        }
+        ops[tid] = n;
+        bench::consume(sum);
+    });
+
+    timer.join();
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+
+    std::cout << Queue::name() << ',' << nthreads << ',' << heaps << ',' << insert_pct << ','
+              << prefill << ',' << elapsed << ',' << total << ','
+              << static_cast<uint64_t>(total / elapsed) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "queue,threads,heaps,insert_pct,prefill,seconds,ops,ops_per_sec" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4,8,16,32,64")) {
+        for (const std::string &queue : opts.getList("queues", "tsx,guard,mutex")) {
+            if (queue == "tsx") {
+                run<TSXQueue>(opts, nthreads, retries);
+            } else if (queue == "guard") {
+                run<LockedHeap<bench::GuardSync> >(opts, nthreads, retries);
+            } else if (queue == "mutex") {
+                run<LockedHeap<bench::MutexSync> >(opts, nthreads, retries);
+            } else {
+                std::cerr << "Unknown queue: " << queue << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
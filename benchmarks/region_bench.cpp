@@ -0,0 +1,108 @@
+// Abort rates of transactions on a large table by where its memory comes from.
+//
+// Usage: ./region_bench [--threads=1,4] [--table-mb=256] [--updates=8]
+//                       [--impls=heap,heap-touched,region]
+//                       [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Every operation adds one to --updates random counters of the table in
+// one TSXGuardWithStats. The table is
+//   heap:          fresh from malloc, its pages are faulted in by the
+//                  first transactions (or the fall-back lock) touching them
+//   heap-touched:  from malloc and written once before the run, on 4KiB pages
+//   region:        from a TSX::HugeRegion, pre-populated on huge pages
+// heap against heap-touched shows the cost of first-touch faults,
+// heap-touched against region the cost of TLB misses.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXHugeRegion.hpp"
+#include "../include/TSXProfile.hpp"
+
+void run(const bench::Options &opts, const std::string &impl, int nthreads, int retries) {
+    const long table_mb = opts.getInt("table-mb", 256);
+    const long updates = opts.getInt("updates", 8);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+    const std::size_t bytes = table_mb * 1024 * 1024;
+    const long slots = bytes / sizeof(long);
+
+    TSX::HugeRegion *region = nullptr;
+    long *table;
+    if (impl == "region") {
+        region = new TSX::HugeRegion(bytes);
+        table = TSX::RegionAllocator<long>(*region).allocate(slots);
+    } else {
+        table = static_cast<long *>(std::malloc(bytes));
+        if (impl == "heap-touched") std::memset(table, 0, bytes);
+    }
+
+    std::vector<TSX::TSXStats> stats(nthreads);
+    std::vector<uint64_t> ops(nthreads, 0);
+    TSX::SpinLock lock;
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        std::vector<long> picked(updates);
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (long i = 0; i < updates; i++) picked[i] = rng.below(slots);
+            {
+                unsigned char status = 0;
+                TSX::TSXGuardWithStats guard(retries, lock, status, stats[tid]);
+                for (long i = 0; i < updates; i++) table[picked[i]]++;
+            }
+            n++;
+        }
+        ops[tid] = n;
+    });
+
+    timer.join();
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+    TSX::TSXStats all = TSX::total_stats(stats);
+
+    std::cout << impl << ',' << nthreads << ',' << table_mb << ',' << updates << ',' << elapsed << ','
+              << total << ',' << static_cast<uint64_t>(total / elapsed) << ','
+              << static_cast<double>(all.tx_aborts) / total << ','
+              << static_cast<double>(all.tx_lacqs) / total << ','
+              << (region && region->hugetlb_backed() ? "hugetlb" : region ? "thp" : "none") << ','
+              << bench::stats_csv(all, true) << std::endl;
+
+    if (region) {
+        delete region;
+    } else {
+        std::free(table);
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    const int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "impl,threads,table_mb,updates,seconds,ops,ops_per_sec,aborts_per_op,fallbacks_per_op,"
+                  << "huge_pages," << bench::stats_csv_header() << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,4")) {
+        for (const std::string &impl : opts.getList("impls", "heap,heap-touched,region")) {
+            if (impl != "heap" && impl != "heap-touched" && impl != "region") {
+                std::cerr << "Unknown implementation: " << impl << std::endl;
+                return 1;
+            }
+            run(opts, impl, nthreads, retries);
+        }
+    }
+
+    return 0;
+}
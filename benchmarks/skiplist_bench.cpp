@@ -0,0 +1,295 @@
+// TSX::SkipList against a mutex protected std::map and a
+// lock-free skip list.
+//
+// Usage: ./skiplist_bench [--threads=1,2,4,8] [--lists=tsx,map,lockfree]
+//                         [--keys=1048576] [--find-pct=50] [--insert-pct=25]
+//                         [--duration-ms=1000] [--retries=N] [--no-header]
+//
+// Keys are drawn uniformly from [0, --keys), half of them are inserted
+// before the run, erases take the share left after finds and inserts.
+
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "../include/TSXSkipList.hpp"
+
+// Lock-free skip list (Herlihy & Shavit, "The Art of Multiprocessor
+// Programming", 14.4) with the mark bit in the low bit of the next
+// pointers. Nodes are never reclaimed while the list is alive.
+class LockFreeSkipList {
+private:
+    static constexpr int MAX_LEVEL = 24;
+
+    struct Node {
+        long key;
+        long value;
+        int height;
+        Node *allocated_next;
+        std::atomic<uintptr_t> next[MAX_LEVEL];
+    };
+
+    Node *head, *tail;
+    std::atomic<Node *> allocated;
+
+    static Node *ptr(uintptr_t raw) { return reinterpret_cast<Node *>(raw & ~uintptr_t(1)); }
+    static bool marked(uintptr_t raw) { return raw & 1; }
+    static uintptr_t raw(Node *n) { return reinterpret_cast<uintptr_t>(n); }
+
+    Node *make_node(long key, long value, int height) {
+        Node *n = new Node;
+        n->key = key;
+        n->value = value;
+        n->height = height;
+        for (int i = 0; i < MAX_LEVEL; i++) n->next[i].store(0, std::memory_order_relaxed);
+        Node *top = allocated.load(std::memory_order_relaxed);
+        do {
+            n->allocated_next = top;
+        } while (!allocated.compare_exchange_weak(top, n));
+        return n;
+    }
+
+    static int random_height(bench::XorShift &rng) {
+        return 1 + __builtin_ctzll(rng.next() | (1ull << (MAX_LEVEL - 1)));
+    }
+
+    // find: fills preds/succs, unlinking marked nodes on the way
+    bool find(long key, Node **preds, Node **succs) {
+    retry:
+        Node *pred = head, *curr = nullptr;
+        for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+            curr = ptr(pred->next[level].load());
+            for (;;) {
+                uintptr_t succ = curr->next[level].load();
+                while (marked(succ)) {
+                    uintptr_t expected = raw(curr);
+                    if (!pred->next[level].compare_exchange_strong(expected, raw(ptr(succ)))) goto retry;
+                    curr = ptr(pred->next[level].load());
+                    succ = curr->next[level].load();
+                }
+                if (curr->key < key) {
+                    pred = curr;
+                    curr = ptr(succ);
+                } else {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return curr->key == key;
+    }
+
+public:
+    LockFreeSkipList(int): allocated(nullptr) {
+        head = make_node(LONG_MIN, 0, MAX_LEVEL);
+        tail = make_node(LONG_MAX, 0, MAX_LEVEL);
+        for (int i = 0; i < MAX_LEVEL; i++) head->next[i].store(raw(tail));
+    }
+
+    ~LockFreeSkipList() {
+        Node *n = allocated.load();
+        while (n) {
+            Node *next = n->allocated_next;
+            delete n;
+            n = next;
+        }
+    }
+
+    static const char *name() { return "lock-free skiplist"; }
+
+    bool find(long key, long &value) {
+        Node *pred = head, *curr = nullptr;
+        for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+            curr = ptr(pred->next[level].load());
+            for (;;) {
+                uintptr_t succ = curr->next[level].load();
+                while (marked(succ)) {
+                    curr = ptr(succ);
+                    succ = curr->next[level].load();
+                }
+                if (curr->key < key) {
+                    pred = curr;
+                    curr = ptr(succ);
+                } else {
+                    break;
+                }
+            }
+        }
+        if (curr->key != key) return false;
+        value = curr->value;
+        return true;
+    }
+
+    bool insert(long key, long value, bench::XorShift &rng) {
+        Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        int height = random_height(rng);
+        for (;;) {
+            if (find(key, preds, succs)) return false;
+
+            Node *n = make_node(key, value, height);
+            for (int i = 0; i < height; i++) n->next[i].store(raw(succs[i]), std::memory_order_relaxed);
+
+            uintptr_t expected = raw(succs[0]);
+            if (!preds[0]->next[0].compare_exchange_strong(expected, raw(n))) continue;
+
+            for (int level = 1; level < height; level++) {
+                for (;;) {
+                    // point the new node at the current successor, unless it is being erased
+                    uintptr_t mine = n->next[level].load();
+                    if (marked(mine)) return true;
+                    if (ptr(mine) != succs[level] &&
+                        !n->next[level].compare_exchange_strong(mine, raw(succs[level]))) return true;
+
+                    expected = raw(succs[level]);
+                    if (preds[level]->next[level].compare_exchange_strong(expected, raw(n))) break;
+                    find(key, preds, succs);
+                }
+            }
+            return true;
+        }
+    }
+
+    bool erase(long key) {
+        Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        if (!find(key, preds, succs)) return false;
+
+        Node *victim = succs[0];
+        for (int level = victim->height - 1; level >= 1; level--) {
+            uintptr_t succ = victim->next[level].load();
+            while (!marked(succ)) {
+                victim->next[level].compare_exchange_strong(succ, succ | 1);
+            }
+        }
+
+        uintptr_t succ = victim->next[0].load();
+        for (;;) {
+            if (marked(succ)) return false;
+            if (victim->next[0].compare_exchange_strong(succ, succ | 1)) {
+                find(key, preds, succs);
+                return true;
+            }
+        }
+    }
+};
+
+class MutexMap {
+private:
+    std::mutex lock;
+    std::map<long, long> map;
+public:
+    MutexMap(int) {}
+
+    static const char *name() { return "mutex std::map"; }
+
+    bool find(long key, long &value) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    bool insert(long key, long value, bench::XorShift &) {
+        std::lock_guard<std::mutex> guard(lock);
+        return map.insert(std::make_pair(key, value)).second;
+    }
+
+    bool erase(long key) {
+        std::lock_guard<std::mutex> guard(lock);
+        return map.erase(key) != 0;
+    }
+};
+
+class TSXList {
+private:
+    TSX::SkipList<long, long> list;
+public:
+    TSXList(int retries): list(retries) {}
+
+    static const char *name() { return "TSX::SkipList"; }
+
+    bool find(long key, long &value) { return list.find(key, value); }
+    bool insert(long key, long value, bench::XorShift &) { return list.insert(key, value); }
+    bool erase(long key) { return list.erase(key); }
+};
+
+template <class List>
+void run(const bench::Options &opts, int nthreads, int retries) {
+    const long keys = opts.getInt("keys", 1 << 20);
+    const int find_pct = opts.getInt("find-pct", 50);
+    const int insert_pct = opts.getInt("insert-pct", 25);
+    const long duration_ms = opts.getInt("duration-ms", 1000);
+
+    List list(retries);
+    bench::XorShift fill(1);
+    for (long k = 0; k < keys; k += 2) list.insert(k, k, fill);
+
+    std::vector<uint64_t> ops(nthreads, 0);
+    std::atomic<bool> stop(false);
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+    });
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        bench::XorShift rng(tid + 1);
+        uint64_t n = 0;
+        long sum = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            long key = rng.below(keys);
+            int r = rng.below(100);
+            if (r < find_pct) {
+                long value = 0;
+                if (list.find(key, value)) sum += value;
+            } else if (r < find_pct + insert_pct) {
+                list.insert(key, key, rng);
+            } else {
+                list.erase(key);
+            }
+            n++;
+        }
+        ops[tid] = n;
+        bench::consume(sum);
+    });
+
+    timer.join();
+
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+
+    std::cout << List::name() << ',' << nthreads << ',' << keys << ',' << find_pct << ','
+              << insert_pct << ',' << elapsed << ',' << total << ','
+              << static_cast<uint64_t>(total / elapsed) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    int retries = opts.getInt("retries", TSX::machine_profile().max_retries);
+
+    if (!opts.has("no-header")) {
+        std::cout << "list,threads,keys,find_pct,insert_pct,seconds,ops,ops_per_sec" << std::endl;
+    }
+
+    for (long nthreads : opts.getIntList("threads", "1,2,4,8")) {
+        for (const std::string &list : opts.getList("lists", "tsx,map,lockfree")) {
+            if (list == "tsx") {
+                run<TSXList>(opts, nthreads, retries);
+            } else if (list == "map") {
+                run<MutexMap>(opts, nthreads, retries);
+            } else if (list == "lockfree") {
+                run<LockFreeSkipList>(opts, nthreads, retries);
+            } else {
+                std::cerr << "Unknown list: " << list << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
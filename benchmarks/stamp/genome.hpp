@@ -0,0 +1,194 @@
+#ifndef BENCHMARKS_STAMP_GENOME_HPP
+
+    #define BENCHMARKS_STAMP_GENOME_HPP
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../bench_common.hpp"
+
+namespace stamp {
+
+    // Genome: STAMP genome, gene sequencing.
+    // Overlapping segments sampled from a random gene are
+    //  1. deduplicated through a shared hash set,
+    //  2. linked to the segment with the longest overlap,
+    //     trying overlap lengths from longest to shortest,
+    //     each round hashing the candidate prefixes into a
+    //     shared table and linking suffix/prefix matches,
+    //  3. walked sequentially to rebuild the gene.
+    // Steps 1 and 2 run as many small transactions.
+    class Genome {
+    private:
+        const int gene_length, segment_length, nextra;
+
+        std::string gene;
+        std::vector<char> segments;     // nsegments x segment_length
+        int nsegments;
+
+        // step 1, shared
+        std::vector<int> set_slots;     // segment index or -1
+        std::vector<int> unique;
+        int nunique;
+
+        // step 2, shared
+        std::vector<int> bucket_heads;
+        std::vector<int> bucket_next;
+        std::vector<int> successor;     // -1 if none
+        std::vector<int> overlap;
+        std::vector<char> has_predecessor;
+
+        std::string rebuilt;
+
+        const char *segment(int i) const {
+            return &segments[static_cast<size_t>(i) * segment_length];
+        }
+
+        static uint64_t hash(const char *s, int n) {
+            uint64_t h = 1469598103934665603ull;
+            for (int i = 0; i < n; i++) h = (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ull;
+            return h;
+        }
+
+        static int pow2_at_least(int n) {
+            int p = 1;
+            while (p < n) p *= 2;
+            return p;
+        }
+
+    public:
+        static const char *name() { return "genome"; }
+
+        explicit Genome(const bench::Options &opts):
+        gene_length(opts.getInt("gene-length", 16384)),
+        segment_length(opts.getInt("segment-length", 64)),
+        nextra(opts.getInt("extra-segments", 8192)),
+        nsegments(0),
+        nunique(0)
+        {
+            bench::XorShift rng(3);
+            static const char bases[] = "ACGT";
+            for (int i = 0; i < gene_length; i++) gene += bases[rng.below(4)];
+
+            // every half segment, so consecutive segments overlap
+            // by at least half their length, plus random extras
+            std::vector<int> starts;
+            for (int s = 0; s + segment_length < gene_length; s += segment_length / 2) starts.push_back(s);
+            starts.push_back(gene_length - segment_length);
+            for (int i = 0; i < nextra; i++) starts.push_back(rng.below(gene_length - segment_length + 1));
+
+            for (size_t i = starts.size(); i > 1; i--) std::swap(starts[i - 1], starts[rng.below(i)]);
+
+            nsegments = starts.size();
+            segments.resize(static_cast<size_t>(nsegments) * segment_length);
+            for (int i = 0; i < nsegments; i++) {
+                std::memcpy(&segments[static_cast<size_t>(i) * segment_length],
+                    gene.data() + starts[i], segment_length);
+            }
+
+            set_slots.assign(pow2_at_least(2 * nsegments), -1);
+            unique.assign(nsegments, -1);
+            bucket_heads.assign(pow2_at_least(2 * nsegments), -1);
+            bucket_next.assign(nsegments, -1);
+            successor.assign(nsegments, -1);
+            overlap.assign(nsegments, 0);
+            has_predecessor.assign(nsegments, 0);
+        }
+
+        template <class Sync>
+        void work(Sync &sync, int tid, int nthreads, bench::Barrier &barrier, TSX::TSXStats &stats) {
+            const int mask = set_slots.size() - 1;
+
+            // step 1: deduplicate
+            for (int i = tid; i < nsegments; i += nthreads) {
+                const char *s = segment(i);
+                int start = hash(s, segment_length) & mask;
+
+                sync.critical([&]() {
+                    for (int slot = start; ; slot = (slot + 1) & mask) {
+                        if (set_slots[slot] < 0) {
+                            set_slots[slot] = i;
+                            unique[nunique++] = i;
+                            return;
+                        }
+                        if (std::memcmp(segment(set_slots[slot]), s, segment_length) == 0) return;
+                    }
+                }, stats);
+            }
+
+            barrier.wait();
+
+            // step 2: link segments, longest overlap first
+            const int nbuckets = bucket_heads.size();
+            const int bmask = nbuckets - 1;
+
+            for (int k = segment_length - 1; k >= segment_length / 2; k--) {
+                for (int b = tid; b < nbuckets; b += nthreads) bucket_heads[b] = -1;
+
+                barrier.wait();
+
+                // segments still without a predecessor, by prefix
+                for (int u = tid; u < nunique; u += nthreads) {
+                    int t = unique[u];
+                    if (has_predecessor[t]) continue;
+                    int b = hash(segment(t), k) & bmask;
+
+                    sync.critical([&]() {
+                        bucket_next[t] = bucket_heads[b];
+                        bucket_heads[b] = t;
+                    }, stats);
+                }
+
+                barrier.wait();
+
+                // segments still without a successor look for a prefix
+                // equal to their suffix
+                for (int u = tid; u < nunique; u += nthreads) {
+                    int s = unique[u];
+                    if (successor[s] >= 0) continue;
+                    const char *suffix = segment(s) + segment_length - k;
+                    int b = hash(suffix, k) & bmask;
+
+                    sync.critical([&]() {
+                        for (int t = bucket_heads[b]; t >= 0; t = bucket_next[t]) {
+                            if (t == s || has_predecessor[t]) continue;
+                            if (std::memcmp(segment(t), suffix, k) != 0) continue;
+                            successor[s] = t;
+                            overlap[s] = k;
+                            has_predecessor[t] = 1;
+                            return;
+                        }
+                    }, stats);
+                }
+
+                barrier.wait();
+            }
+
+            // step 3: rebuild
+            if (tid == 0) {
+                int first = -1;
+                for (int u = 0; u < nunique; u++) {
+                    if (!has_predecessor[unique[u]]) {
+                        if (first >= 0) return;     // more than one chain
+                        first = unique[u];
+                    }
+                }
+                if (first < 0) return;
+
+                rebuilt.assign(segment(first), segment_length);
+                for (int s = first; successor[s] >= 0; s = successor[s]) {
+                    int t = successor[s];
+                    rebuilt.append(segment(t) + overlap[s], segment_length - overlap[s]);
+                }
+            }
+        }
+
+        bool validate() const {
+            return rebuilt == gene;
+        }
+    };
+
+};
+
+#endif
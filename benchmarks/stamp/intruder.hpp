@@ -0,0 +1,137 @@
+#ifndef BENCHMARKS_STAMP_INTRUDER_HPP
+
+    #define BENCHMARKS_STAMP_INTRUDER_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "../bench_common.hpp"
+
+namespace stamp {
+
+    // Intruder: STAMP intruder, network intrusion detection.
+    // Threads pop fragmented packets from a shared stream,
+    // reassemble them into their flows and, once a flow is
+    // complete, scan it for the attack signature. Popping
+    // and reassembly are transactions, the scan is not.
+    // STAMP reassembles in a red-black tree of flows,
+    // here flows are preallocated and indexed by id.
+    class Intruder {
+    private:
+        struct Packet {
+            int flow;
+            int offset;
+            int length;
+            int nfragments;
+        };
+
+        struct alignas(bench::CACHE_LINE) Flow {
+            int received;
+        };
+
+        const int nflows, flow_length, max_fragments, attack_percent;
+
+        std::vector<char> source;       // original flow contents
+        std::vector<Packet> stream;     // fragments, shuffled
+
+        // shared, updated in critical sections
+        int next_packet;
+        int detected;
+        std::vector<Flow> flows;
+        std::vector<char> reassembled;
+
+        int expected_attacks;
+
+        static const char *signature() { return "attack"; }
+
+    public:
+        static const char *name() { return "intruder"; }
+
+        explicit Intruder(const bench::Options &opts):
+        nflows(opts.getInt("flows", 16384)),
+        flow_length(opts.getInt("flow-length", 128)),
+        max_fragments(opts.getInt("max-fragments", 8)),
+        attack_percent(opts.getInt("attack-pct", 10)),
+        source(static_cast<size_t>(nflows) * flow_length),
+        next_packet(0),
+        detected(0),
+        flows(nflows),
+        reassembled(static_cast<size_t>(nflows) * flow_length),
+        expected_attacks(0)
+        {
+            bench::XorShift rng(11);
+            const int siglen = std::strlen(signature());
+
+            for (int f = 0; f < nflows; f++) {
+                char *data = &source[static_cast<size_t>(f) * flow_length];
+                // digits only, so the signature cannot appear by chance
+                for (int i = 0; i < flow_length; i++) data[i] = '0' + rng.below(10);
+                if (static_cast<int>(rng.below(100)) < attack_percent && flow_length >= siglen) {
+                    std::memcpy(data + rng.below(flow_length - siglen + 1), signature(), siglen);
+                    expected_attacks++;
+                }
+
+                int nfragments = 1 + rng.below(max_fragments);
+                if (nfragments > flow_length) nfragments = flow_length;
+                int fragment_length = flow_length / nfragments;
+                for (int i = 0; i < nfragments; i++) {
+                    Packet p;
+                    p.flow = f;
+                    p.offset = i * fragment_length;
+                    p.length = i == nfragments - 1 ? flow_length - p.offset : fragment_length;
+                    p.nfragments = nfragments;
+                    stream.push_back(p);
+                }
+
+                flows[f].received = 0;
+            }
+
+            for (size_t i = stream.size(); i > 1; i--) {
+                std::swap(stream[i - 1], stream[rng.below(i)]);
+            }
+        }
+
+        template <class Sync>
+        void work(Sync &sync, int, int, bench::Barrier &, TSX::TSXStats &stats) {
+            const int npackets = stream.size();
+            const int siglen = std::strlen(signature());
+
+            for (;;) {
+                int index = 0;
+                sync.critical([&]() {
+                    index = next_packet;
+                    if (next_packet < npackets) next_packet++;
+                }, stats);
+                if (index >= npackets) break;
+
+                const Packet &p = stream[index];
+                const char *fragment = &source[static_cast<size_t>(p.flow) * flow_length + p.offset];
+                char *flow_data = &reassembled[static_cast<size_t>(p.flow) * flow_length];
+
+                bool complete = false;
+                sync.critical([&]() {
+                    std::memcpy(flow_data + p.offset, fragment, p.length);
+                    complete = ++flows[p.flow].received == p.nfragments;
+                }, stats);
+                if (!complete) continue;
+
+                // the flow is complete, no one else writes to it anymore
+                bool attack = std::search(flow_data, flow_data + flow_length,
+                    signature(), signature() + siglen) != flow_data + flow_length;
+                if (attack) {
+                    sync.critical([&]() {
+                        detected++;
+                    }, stats);
+                }
+            }
+        }
+
+        bool validate() const {
+            return detected == expected_attacks && reassembled == source;
+        }
+    };
+
+};
+
+#endif
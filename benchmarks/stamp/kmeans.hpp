@@ -0,0 +1,160 @@
+#ifndef BENCHMARKS_STAMP_KMEANS_HPP
+
+    #define BENCHMARKS_STAMP_KMEANS_HPP
+
+#include <vector>
+
+#include "../bench_common.hpp"
+
+namespace stamp {
+
+    // KMeans: STAMP kmeans. Points are grabbed in chunks
+    // from a shared cursor, assigned to the nearest center
+    // outside of any critical section and accumulated into
+    // the shared per cluster sums inside one.
+    // Few clusters (--clusters=15) give high contention,
+    // many (--clusters=40) low contention.
+    class KMeans {
+    private:
+        static constexpr int CHUNK = 16;
+
+        const int npoints, ndims, nclusters, max_iterations;
+        const double threshold;
+
+        std::vector<float> points;          // npoints x ndims
+        std::vector<int> membership;
+        std::vector<float> centers;         // nclusters x ndims
+
+        // shared, updated in critical sections
+        std::vector<float> new_centers;     // nclusters x ndims
+        std::vector<int> new_sizes;
+        int next_point;
+        int delta;
+
+        bool done;
+        bool sizes_consistent;
+
+        int nearest(const float *p) const {
+            int best = 0;
+            float best_dist = 0;
+            for (int k = 0; k < nclusters; k++) {
+                float dist = 0;
+                for (int d = 0; d < ndims; d++) {
+                    float diff = p[d] - centers[k * ndims + d];
+                    dist += diff * diff;
+                }
+                if (k == 0 || dist < best_dist) {
+                    best = k;
+                    best_dist = dist;
+                }
+            }
+            return best;
+        }
+
+    public:
+        static const char *name() { return "kmeans"; }
+
+        explicit KMeans(const bench::Options &opts):
+        npoints(opts.getInt("points", 16384)),
+        ndims(opts.getInt("dims", 16)),
+        nclusters(opts.getInt("clusters", 15)),
+        max_iterations(opts.getInt("iterations", 20)),
+        threshold(opts.getDouble("kmeans-threshold", 0.001)),
+        points(npoints * ndims),
+        membership(npoints, -1),
+        centers(nclusters * ndims),
+        new_centers(nclusters * ndims, 0),
+        new_sizes(nclusters, 0),
+        next_point(0),
+        delta(0),
+        done(false),
+        sizes_consistent(true)
+        {
+            // points scattered around nclusters hidden centers
+            bench::XorShift rng(42);
+            std::vector<float> hidden(nclusters * ndims);
+            for (auto &c : hidden) c = rng.uniform() * 100;
+
+            for (int i = 0; i < npoints; i++) {
+                int k = rng.below(nclusters);
+                for (int d = 0; d < ndims; d++) {
+                    float noise = (rng.uniform() + rng.uniform() + rng.uniform() - 1.5) * 10;
+                    points[i * ndims + d] = hidden[k * ndims + d] + noise;
+                }
+            }
+
+            // the first points are the initial centers
+            for (int k = 0; k < nclusters; k++) {
+                for (int d = 0; d < ndims; d++) centers[k * ndims + d] = points[k * ndims + d];
+            }
+        }
+
+        template <class Sync>
+        void work(Sync &sync, int tid, int, bench::Barrier &barrier, TSX::TSXStats &stats) {
+            for (int iteration = 0; iteration < max_iterations; iteration++) {
+                int local_delta = 0;
+
+                for (;;) {
+                    int start = 0;
+                    sync.critical([&]() {
+                        start = next_point;
+                        next_point += CHUNK;
+                    }, stats);
+                    if (start >= npoints) break;
+
+                    int end = start + CHUNK < npoints ? start + CHUNK : npoints;
+                    for (int i = start; i < end; i++) {
+                        const float *p = &points[i * ndims];
+                        int k = nearest(p);
+                        if (membership[i] != k) local_delta++;
+                        membership[i] = k;
+
+                        sync.critical([&]() {
+                            for (int d = 0; d < ndims; d++) new_centers[k * ndims + d] += p[d];
+                            new_sizes[k]++;
+                        }, stats);
+                    }
+                }
+
+                sync.critical([&]() {
+                    delta += local_delta;
+                }, stats);
+
+                barrier.wait();
+
+                if (tid == 0) {
+                    int assigned = 0;
+                    for (int k = 0; k < nclusters; k++) {
+                        assigned += new_sizes[k];
+                        for (int d = 0; d < ndims; d++) {
+                            if (new_sizes[k] > 0) {
+                                centers[k * ndims + d] = new_centers[k * ndims + d] / new_sizes[k];
+                            }
+                            new_centers[k * ndims + d] = 0;
+                        }
+                        new_sizes[k] = 0;
+                    }
+                    sizes_consistent = sizes_consistent && assigned == npoints;
+                    done = static_cast<double>(delta) / npoints < threshold;
+                    delta = 0;
+                    next_point = 0;
+                }
+
+                barrier.wait();
+
+                if (done) break;
+            }
+        }
+
+        bool validate() const {
+            if (!sizes_consistent) return false;
+            for (int m : membership) {
+                if (m < 0 || m >= nclusters) return false;
+            }
+            return true;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef BENCHMARKS_STAMP_SSCA2_HPP
+
+    #define BENCHMARKS_STAMP_SSCA2_HPP
+
+#include <vector>
+
+#include "../bench_common.hpp"
+
+namespace stamp {
+
+    // SSCA2: STAMP ssca2 kernel 1, building the adjacency
+    // arrays of a graph from its edge list. Every edge costs
+    // two tiny transactions, one counting the out degree and
+    // one claiming a position in the adjacency array, so the
+    // run time is dominated by transaction overhead.
+    // Edge sources are skewed towards low vertex ids.
+    class SSCA2 {
+    private:
+        const int nvertices;
+        const long nedges;
+
+        std::vector<int> edge_from, edge_to;
+
+        // shared, updated in critical sections
+        std::vector<int> degree;
+        std::vector<int> fill;
+
+        std::vector<long> offsets;      // nvertices + 1
+        std::vector<int> adjacency;
+
+    public:
+        static const char *name() { return "ssca2"; }
+
+        explicit SSCA2(const bench::Options &opts):
+        nvertices(1 << opts.getInt("scale", 16)),
+        nedges(static_cast<long>(nvertices) * opts.getInt("edge-factor", 8)),
+        edge_from(nedges),
+        edge_to(nedges),
+        degree(nvertices, 0),
+        fill(nvertices, 0),
+        offsets(nvertices + 1, 0),
+        adjacency(nedges)
+        {
+            bench::XorShift rng(5);
+            for (long e = 0; e < nedges; e++) {
+                edge_from[e] = rng.below(rng.below(nvertices) + 1);
+                edge_to[e] = rng.below(nvertices);
+            }
+        }
+
+        template <class Sync>
+        void work(Sync &sync, int tid, int nthreads, bench::Barrier &barrier, TSX::TSXStats &stats) {
+            long begin = nedges * tid / nthreads;
+            long end = nedges * (tid + 1) / nthreads;
+
+            for (long e = begin; e < end; e++) {
+                int u = edge_from[e];
+                sync.critical([&]() {
+                    degree[u]++;
+                }, stats);
+            }
+
+            barrier.wait();
+
+            if (tid == 0) {
+                for (int v = 0; v < nvertices; v++) offsets[v + 1] = offsets[v] + degree[v];
+            }
+
+            barrier.wait();
+
+            for (long e = begin; e < end; e++) {
+                int u = edge_from[e];
+                int v = edge_to[e];
+                sync.critical([&]() {
+                    adjacency[offsets[u] + fill[u]++] = v;
+                }, stats);
+            }
+        }
+
+        bool validate() const {
+            if (offsets[nvertices] != nedges) return false;
+
+            std::vector<long> expected(nvertices, 0);
+            for (long e = 0; e < nedges; e++) expected[edge_from[e]] += edge_to[e];
+
+            for (int u = 0; u < nvertices; u++) {
+                if (fill[u] != degree[u]) return false;
+                long sum = 0;
+                for (long i = offsets[u]; i < offsets[u + 1]; i++) sum += adjacency[i];
+                if (sum != expected[u]) return false;
+            }
+            return true;
+        }
+    };
+
+};
+
+#endif
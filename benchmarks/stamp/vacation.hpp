@@ -0,0 +1,159 @@
+#ifndef BENCHMARKS_STAMP_VACATION_HPP
+
+    #define BENCHMARKS_STAMP_VACATION_HPP
+
+#include <vector>
+
+#include "../bench_common.hpp"
+
+namespace stamp {
+
+    // Vacation: STAMP vacation, a travel reservation system.
+    // Clients make reservations over cars, flights and rooms,
+    // delete customers (cancelling all their reservations)
+    // and update the offered items, each as one transaction.
+    // STAMP keeps the relations in red-black trees, here they
+    // are preallocated arrays of cache line sized records,
+    // which keeps the transactional footprint of a query
+    // (--queries records) but not the tree traversal.
+    class Vacation {
+    private:
+        enum { CAR = 0, FLIGHT, ROOM, NTYPES };
+        static constexpr int MAX_RESERVATIONS = 8;
+
+        struct alignas(bench::CACHE_LINE) Resource {
+            int total;
+            int used;
+            int price;
+        };
+
+        struct Reservation {
+            int type;
+            int id;
+            int price;
+        };
+
+        struct alignas(bench::CACHE_LINE) Customer {
+            int nreservations;
+            Reservation reservations[MAX_RESERVATIONS];
+        };
+
+        enum Action { MAKE_RESERVATION, DELETE_CUSTOMER, UPDATE_TABLES };
+
+        const int nrelations, nqueries, user_percent;
+        const long nops;
+
+        std::vector<Resource> tables[NTYPES];
+        std::vector<Customer> customers;
+
+    public:
+        static const char *name() { return "vacation"; }
+
+        explicit Vacation(const bench::Options &opts):
+        nrelations(opts.getInt("relations", 16384)),
+        nqueries(opts.getInt("queries", 4)),
+        user_percent(opts.getInt("user-pct", 90)),
+        nops(opts.getInt("vacation-ops", 262144)),
+        customers(nrelations)
+        {
+            bench::XorShift rng(7);
+            for (int t = 0; t < NTYPES; t++) {
+                tables[t].resize(nrelations);
+                for (Resource &r : tables[t]) {
+                    r.total = 100 * (rng.below(5) + 1);
+                    r.used = 0;
+                    r.price = 50 * (rng.below(5) + 1);
+                }
+            }
+            for (Customer &c : customers) c.nreservations = 0;
+        }
+
+        template <class Sync>
+        void work(Sync &sync, int tid, int nthreads, bench::Barrier &, TSX::TSXStats &stats) {
+            bench::XorShift rng(tid + 1);
+            std::vector<int> types(nqueries), ids(nqueries), adds(nqueries);
+            long my_ops = nops / nthreads + (tid < nops % nthreads ? 1 : 0);
+
+            for (long op = 0; op < my_ops; op++) {
+                // all random choices are made outside of the transaction
+                int r = rng.below(100);
+                Action action = r < user_percent ? MAKE_RESERVATION :
+                    (r & 1) ? DELETE_CUSTOMER : UPDATE_TABLES;
+                int customer_id = rng.below(nrelations);
+                for (int q = 0; q < nqueries; q++) {
+                    types[q] = rng.below(NTYPES);
+                    ids[q] = rng.below(nrelations);
+                    adds[q] = rng.below(2);
+                }
+
+                if (action == MAKE_RESERVATION) {
+                    sync.critical([&]() {
+                        int best_id[NTYPES] = { -1, -1, -1 };
+                        int best_price[NTYPES] = { -1, -1, -1 };
+                        for (int q = 0; q < nqueries; q++) {
+                            const Resource &res = tables[types[q]][ids[q]];
+                            if (res.used < res.total && res.price > best_price[types[q]]) {
+                                best_id[types[q]] = ids[q];
+                                best_price[types[q]] = res.price;
+                            }
+                        }
+
+                        Customer &c = customers[customer_id];
+                        for (int t = 0; t < NTYPES; t++) {
+                            if (best_id[t] < 0 || c.nreservations == MAX_RESERVATIONS) continue;
+                            tables[t][best_id[t]].used++;
+                            Reservation &rsv = c.reservations[c.nreservations++];
+                            rsv.type = t;
+                            rsv.id = best_id[t];
+                            rsv.price = best_price[t];
+                        }
+                    }, stats);
+                } else if (action == DELETE_CUSTOMER) {
+                    sync.critical([&]() {
+                        Customer &c = customers[customer_id];
+                        for (int i = 0; i < c.nreservations; i++) {
+                            tables[c.reservations[i].type][c.reservations[i].id].used--;
+                        }
+                        c.nreservations = 0;
+                    }, stats);
+                } else {
+                    sync.critical([&]() {
+                        for (int q = 0; q < nqueries; q++) {
+                            Resource &res = tables[types[q]][ids[q]];
+                            if (adds[q]) {
+                                res.total += 100;
+                            } else if (res.total - res.used >= 100) {
+                                res.total -= 100;
+                            } else {
+                                res.price += 10;
+                            }
+                        }
+                    }, stats);
+                }
+            }
+        }
+
+        bool validate() const {
+            std::vector<int> expected[NTYPES];
+            for (int t = 0; t < NTYPES; t++) expected[t].assign(nrelations, 0);
+
+            for (const Customer &c : customers) {
+                if (c.nreservations < 0 || c.nreservations > MAX_RESERVATIONS) return false;
+                for (int i = 0; i < c.nreservations; i++) {
+                    expected[c.reservations[i].type][c.reservations[i].id]++;
+                }
+            }
+
+            for (int t = 0; t < NTYPES; t++) {
+                for (int i = 0; i < nrelations; i++) {
+                    const Resource &res = tables[t][i];
+                    if (res.used != expected[t][i] || res.used > res.total) return false;
+                }
+            }
+            return true;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,95 @@
+// STAMP style application benchmarks.
+//
+// Usage: ./stamp_bench [--apps=kmeans,vacation,intruder,genome,ssca2]
+//                      [--sync=sequential,spinlock,guard,guard_stats]
+//                      [--threads=1,2,4] [--retries=20] [--no-header]
+//                      [application options, see stamp/*.hpp]
+//
+// Ports of a subset of the STAMP suite onto the synchronization
+// policies of bench_common.hpp. "sequential" runs once, single
+// threaded and without synchronization, as the baseline,
+// "spinlock" and "mutex" are the lock only baselines.
+// Every run validates its output, one CSV row per run.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "stamp/genome.hpp"
+#include "stamp/intruder.hpp"
+#include "stamp/kmeans.hpp"
+#include "stamp/ssca2.hpp"
+#include "stamp/vacation.hpp"
+
+template <class App, class Sync>
+void run(const bench::Options &opts, int nthreads, int retries) {
+    App app(opts);
+    Sync sync(retries);
+    bench::Barrier barrier(nthreads);
+    std::vector<TSX::TSXStats> stats(nthreads);
+
+    double elapsed = bench::run_threads(nthreads, [&](int tid) {
+        app.work(sync, tid, nthreads, barrier, stats[tid]);
+    });
+
+    std::cout << App::name() << ',' << Sync::name() << ',' << nthreads << ','
+              << elapsed << ',' << (app.validate() ? "ok" : "FAILED") << ','
+              << bench::stats_csv(TSX::total_stats(stats), Sync::has_stats()) << std::endl;
+}
+
+template <class App>
+bool run_app(const bench::Options &opts, const std::vector<long> &threads, int retries) {
+    for (const std::string &sync : opts.getList("sync", "sequential,spinlock,guard,guard_stats")) {
+        if (sync == "sequential") {
+            run<App, bench::SequentialSync>(opts, 1, retries);
+            continue;
+        }
+        for (long nthreads : threads) {
+            if (sync == "guard") {
+                run<App, bench::GuardSync>(opts, nthreads, retries);
+            } else if (sync == "guard_stats") {
+                run<App, bench::GuardWithStatsSync>(opts, nthreads, retries);
+            } else if (sync == "spinlock") {
+                run<App, bench::SpinLockSync>(opts, nthreads, retries);
+            } else if (sync == "mutex") {
+                run<App, bench::MutexSync>(opts, nthreads, retries);
+            } else {
+                std::cerr << "Unknown sync method: " << sync << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    bench::Options opts(argc, argv);
+    std::vector<long> threads = opts.getIntList("threads", "1,2,4");
+    int retries = opts.getInt("retries", 20);
+
+    if (!opts.has("no-header")) {
+        std::cout << "app,sync,threads,seconds,valid," << bench::stats_csv_header() << std::endl;
+    }
+
+    for (const std::string &app : opts.getList("apps", "kmeans,vacation,intruder,genome,ssca2")) {
+        bool ok;
+        if (app == "kmeans") {
+            ok = run_app<stamp::KMeans>(opts, threads, retries);
+        } else if (app == "vacation") {
+            ok = run_app<stamp::Vacation>(opts, threads, retries);
+        } else if (app == "intruder") {
+            ok = run_app<stamp::Intruder>(opts, threads, retries);
+        } else if (app == "genome") {
+            ok = run_app<stamp::Genome>(opts, threads, retries);
+        } else if (app == "ssca2") {
+            ok = run_app<stamp::SSCA2>(opts, threads, retries);
+        } else {
+            std::cerr << "Unknown application: " << app << std::endl;
+            ok = false;
+        }
+        if (!ok) return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,560 @@
+#ifndef INCLUDE_TSX_BPLUS_TREE_HPP
+
+    #define INCLUDE_TSX_BPLUS_TREE_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // BPlusTree: cache conscious B+tree for in-memory indexes.
+    //
+    // Lookups, leaf inserts and erases are one TSXGuard each:
+    // a descent from the root (reading a few lines per node for
+    // the binary search) and a shift inside one leaf.
+    // Structure changes are separate transactions: an insert
+    // that finds its leaf full splits the highest full node on
+    // its path (together with its parent that is never full,
+    // three nodes in all) and retries, an erase that leaves its
+    // leaf underfull merges it with a sibling, or takes keys from
+    // one too full to merge with, the same way.
+    // If one of them exceeds the transactional capacity the
+    // guard runs it under the fall-back lock.
+    //
+    // The fanout is chosen at construction. By default a node
+    // takes at most 1/8th of the write capacity measured by the
+    // machine profile, so a split (which writes two nodes and
+    // part of a third) stays well inside it.
+    //
+    // Nodes are allocated before a guard is taken and freed
+    // after it is released. Range scans copy up to RANGE_CHUNK
+    // entries per transaction, following the leaf links.
+    template <class K, class V, class Compare = std::less<K> >
+    class BPlusTree {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "BPlusTree keys and values are copied inside transactions and must be trivially copyable");
+
+    public:
+        static constexpr int MIN_FANOUT = 4;
+        static constexpr int MAX_FANOUT = 256;
+        static constexpr int MAX_DEPTH = 32;
+        static constexpr int RANGE_CHUNK = 64;
+
+        // default_fanout: keys per node so that a node
+        // takes at most 1/8th of the write capacity
+        static int default_fanout() {
+            long bytes = static_cast<long>(machine_profile().write_capacity) * CACHE_LINE_SIZE / 8;
+            long fanout = bytes / static_cast<long>(sizeof(K) + sizeof(V));
+            if (fanout < MIN_FANOUT) return MIN_FANOUT;
+            if (fanout > MAX_FANOUT) return MAX_FANOUT;
+            return fanout;
+        }
+
+    private:
+        struct Node {
+            int count;      // keys in the node
+            bool leaf;
+            Node *next;     // right sibling, leaves only
+            // followed by K keys[fanout] and either
+            // V values[fanout] or Node *children[fanout + 1]
+        };
+
+        alignas(ALIGNMENT) Node *root;
+        int depth;                      // levels below the root
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+        const int fanout;
+        const int min_fill;
+        std::size_t keys_offset, slots_offset, node_bytes;
+        Compare less;
+
+        BPlusTree(const BPlusTree &) = delete;
+        BPlusTree &operator=(const BPlusTree &) = delete;
+
+        static std::size_t round_up(std::size_t n, std::size_t to) {
+            return (n + to - 1) / to * to;
+        }
+
+        K *keys(Node *n) const {
+            return reinterpret_cast<K *>(reinterpret_cast<char *>(n) + keys_offset);
+        }
+
+        V *values(Node *n) const {
+            return reinterpret_cast<V *>(reinterpret_cast<char *>(n) + slots_offset);
+        }
+
+        Node **children(Node *n) const {
+            return reinterpret_cast<Node **>(reinterpret_cast<char *>(n) + slots_offset);
+        }
+
+        Node *allocate_node(bool leaf) const {
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, node_bytes);
+            std::memset(mem, 0, node_bytes);
+            Node *n = static_cast<Node *>(mem);
+            n->leaf = leaf;
+            return n;
+        }
+
+        void free_subtree(Node *n) {
+            if (!n->leaf) {
+                for (int i = 0; i <= n->count; i++) free_subtree(children(n)[i]);
+            }
+            std::free(n);
+        }
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+        // first index with keys[i] >= key
+        int lower_bound(Node *n, const K &key) const {
+            const K *k = keys(n);
+            int lo = 0, hi = n->count;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (less(k[mid], key)) lo = mid + 1;
+                else hi = mid;
+            }
+            return lo;
+        }
+
+        // child of internal node n that covers key
+        int child_index(Node *n, const K &key) const {
+            const K *k = keys(n);
+            int lo = 0, hi = n->count;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (less(key, k[mid])) hi = mid;
+                else lo = mid + 1;
+            }
+            return lo;
+        }
+
+        // descend: path[0] is the root, path[depth] the leaf of key,
+        // index[i] the child of path[i] taken
+        void descend(const K &key, Node **path, int *index) const {
+            Node *n = root;
+            for (int level = 0; ; level++) {
+                path[level] = n;
+                if (n->leaf) return;
+                index[level] = child_index(n, key);
+                n = children(n)[index[level]];
+            }
+        }
+
+        bool found_in(Node *leaf, int pos, const K &key) const {
+            return pos < leaf->count && !less(key, keys(leaf)[pos]);
+        }
+
+        // insert_into: inserts key and its value or right child
+        // at pos, n must not be full
+        void insert_into(Node *n, int pos, const K &key, const V *value, Node *right) {
+            K *k = keys(n);
+            std::memmove(k + pos + 1, k + pos, (n->count - pos) * sizeof(K));
+            k[pos] = key;
+            if (n->leaf) {
+                V *v = values(n);
+                std::memmove(v + pos + 1, v + pos, (n->count - pos) * sizeof(V));
+                v[pos] = *value;
+            } else {
+                Node **c = children(n);
+                std::memmove(c + pos + 2, c + pos + 1, (n->count - pos) * sizeof(Node *));
+                c[pos + 1] = right;
+            }
+            n->count++;
+        }
+
+        // split: splits the highest full node on the path of key,
+        // whose parent has room. Uses up to two spare nodes,
+        // returns how many it used.
+        int split(const K &key, Node **spares) {
+            Node *path[MAX_DEPTH + 1];
+            int index[MAX_DEPTH + 1];
+            descend(key, path, index);
+
+            int level = depth;
+            if (path[level]->count < fanout) return 0;     // someone else split it
+            while (level > 0 && path[level - 1]->count == fanout) level--;
+
+            Node *n = path[level];
+            Node *right = spares[0];
+            right->leaf = n->leaf;
+            int mid = n->count / 2;
+            K separator;
+
+            if (n->leaf) {
+                right->count = n->count - mid;
+                std::memcpy(keys(right), keys(n) + mid, right->count * sizeof(K));
+                std::memcpy(values(right), values(n) + mid, right->count * sizeof(V));
+                right->next = n->next;
+                n->next = right;
+                n->count = mid;
+                separator = keys(right)[0];
+            } else {
+                // keys[mid] moves up
+                separator = keys(n)[mid];
+                right->count = n->count - mid - 1;
+                std::memcpy(keys(right), keys(n) + mid + 1, right->count * sizeof(K));
+                std::memcpy(children(right), children(n) + mid + 1, (right->count + 1) * sizeof(Node *));
+                n->count = mid;
+            }
+
+            if (level > 0) {
+                insert_into(path[level - 1], index[level - 1], separator, nullptr, right);
+                return 1;
+            }
+
+            Node *new_root = spares[1];
+            new_root->leaf = false;
+            new_root->count = 1;
+            keys(new_root)[0] = separator;
+            children(new_root)[0] = n;
+            children(new_root)[1] = right;
+            root = new_root;
+            depth++;
+            return 2;
+        }
+
+        // borrow: evens out the keys of left and right, children
+        // li and li + 1 of parent, which are too many for one node
+        void borrow(Node *parent, int li, Node *left, Node *right) {
+            const int total = left->count + right->count;
+            K &separator = keys(parent)[li];
+            K *lk = keys(left);
+            K *rk = keys(right);
+
+            if (left->count < total / 2) {
+                const int m = total / 2 - left->count;
+                if (left->leaf) {
+                    std::memcpy(lk + left->count, rk, m * sizeof(K));
+                    std::memcpy(values(left) + left->count, values(right), m * sizeof(V));
+                    std::memmove(rk, rk + m, (right->count - m) * sizeof(K));
+                    std::memmove(values(right), values(right) + m, (right->count - m) * sizeof(V));
+                } else {
+                    // the separator comes down, keys[m - 1] of right goes up
+                    lk[left->count] = separator;
+                    std::memcpy(lk + left->count + 1, rk, (m - 1) * sizeof(K));
+                    std::memcpy(children(left) + left->count + 1, children(right), m * sizeof(Node *));
+                    separator = rk[m - 1];
+                    std::memmove(rk, rk + m, (right->count - m) * sizeof(K));
+                    std::memmove(children(right), children(right) + m, (right->count - m + 1) * sizeof(Node *));
+                }
+                left->count += m;
+                right->count -= m;
+            } else {
+                const int m = total / 2 - right->count;
+                std::memmove(rk + m, rk, right->count * sizeof(K));
+                if (left->leaf) {
+                    std::memmove(values(right) + m, values(right), right->count * sizeof(V));
+                    std::memcpy(rk, lk + left->count - m, m * sizeof(K));
+                    std::memcpy(values(right), values(left) + left->count - m, m * sizeof(V));
+                } else {
+                    std::memmove(children(right) + m, children(right), (right->count + 1) * sizeof(Node *));
+                    rk[m - 1] = separator;
+                    std::memcpy(rk, lk + left->count - m + 1, (m - 1) * sizeof(K));
+                    std::memcpy(children(right), children(left) + left->count - m + 1, m * sizeof(Node *));
+                    separator = lk[left->count - m];
+                }
+                left->count -= m;
+                right->count += m;
+            }
+            if (left->leaf) separator = rk[0];
+        }
+
+        // rebalance: merges the lowest underfull node on the path of
+        // key with a sibling, or borrows from a sibling too full to
+        // merge with, or collapses a root with a single child. Sets
+        // freed to the node to free, returns false if nothing changed.
+        bool rebalance(const K &key, Node *&freed) {
+            Node *path[MAX_DEPTH + 1];
+            int index[MAX_DEPTH + 1];
+            descend(key, path, index);
+
+            for (int level = depth; level > 0; level--) {
+                Node *n = path[level];
+                if (n->count >= min_fill) continue;
+
+                Node *parent = path[level - 1];
+                if (parent->count == 0) continue;
+                int li = index[level - 1] > 0 ? index[level - 1] - 1 : 0;
+                Node *left = children(parent)[li];
+                Node *right = children(parent)[li + 1];
+
+                int merged = left->count + right->count + (left->leaf ? 0 : 1);
+                if (merged >= fanout) {
+                    borrow(parent, li, left, right);
+                    return true;
+                }
+
+                if (left->leaf) {
+                    std::memcpy(keys(left) + left->count, keys(right), right->count * sizeof(K));
+                    std::memcpy(values(left) + left->count, values(right), right->count * sizeof(V));
+                    left->next = right->next;
+                } else {
+                    keys(left)[left->count] = keys(parent)[li];
+                    std::memcpy(keys(left) + left->count + 1, keys(right), right->count * sizeof(K));
+                    std::memcpy(children(left) + left->count + 1, children(right),
+                        (right->count + 1) * sizeof(Node *));
+                }
+                left->count = merged;
+
+                // drop the separator and the right child from the parent
+                K *pk = keys(parent);
+                Node **pc = children(parent);
+                std::memmove(pk + li, pk + li + 1, (parent->count - li - 1) * sizeof(K));
+                std::memmove(pc + li + 1, pc + li + 2, (parent->count - li - 1) * sizeof(Node *));
+                parent->count--;
+                freed = right;
+                return true;
+            }
+
+            if (!root->leaf && root->count == 0) {
+                freed = root;
+                root = children(root)[0];
+                depth--;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool insert_impl(const K &key, const V &value, bool assign, TSXStats *stats) {
+            enum { INSERTED, EXISTS, FULL } result;
+            Node *spares[2] = { nullptr, nullptr };
+
+            for (;;) {
+                atomically([&]() {
+                    Node *path[MAX_DEPTH + 1];
+                    int index[MAX_DEPTH + 1];
+                    descend(key, path, index);
+                    Node *leaf = path[depth];
+                    int pos = lower_bound(leaf, key);
+                    if (found_in(leaf, pos, key)) {
+                        if (assign) values(leaf)[pos] = value;
+                        result = EXISTS;
+                    } else if (leaf->count < fanout) {
+                        insert_into(leaf, pos, key, &value, nullptr);
+                        result = INSERTED;
+                    } else {
+                        result = FULL;
+                    }
+                }, stats);
+
+                if (result != FULL) break;
+
+                if (!spares[0]) spares[0] = allocate_node(true);
+                if (!spares[1]) spares[1] = allocate_node(false);
+                int used = 0;
+                atomically([&]() {
+                    used = split(key, spares);
+                }, stats);
+                if (used >= 1) spares[0] = nullptr;
+                if (used == 2) spares[1] = nullptr;
+            }
+
+            std::free(spares[0]);
+            std::free(spares[1]);
+            return result == INSERTED;
+        }
+
+    public:
+        explicit BPlusTree(int node_fanout = default_fanout(),
+                           int max_tx_retries = machine_profile().max_retries):
+        depth(0),
+        max_retries(max_tx_retries),
+        fanout(node_fanout < MIN_FANOUT ? MIN_FANOUT : (node_fanout > MAX_FANOUT ? MAX_FANOUT : node_fanout)),
+        min_fill(fanout / 4)
+        {
+            std::size_t slot_align = alignof(V) > alignof(Node *) ? alignof(V) : alignof(Node *);
+            std::size_t slot_bytes = fanout * sizeof(V) > (fanout + 1) * sizeof(Node *) ?
+                fanout * sizeof(V) : (fanout + 1) * sizeof(Node *);
+            keys_offset = round_up(sizeof(Node), alignof(K));
+            slots_offset = round_up(keys_offset + fanout * sizeof(K), slot_align);
+            node_bytes = round_up(slots_offset + slot_bytes, CACHE_LINE_SIZE);
+            root = allocate_node(true);
+        }
+
+        ~BPlusTree() {
+            free_subtree(root);
+        }
+
+        int node_fanout() const { return fanout; }
+
+        // find: copies the value of key into value,
+        // returns false if key is not in the tree
+        bool find(const K &key, V &value, TSXStats *stats = nullptr) {
+            bool found = false;
+            atomically([&]() {
+                Node *n = root;
+                while (!n->leaf) n = children(n)[child_index(n, key)];
+                int pos = lower_bound(n, key);
+                found = found_in(n, pos, key);
+                if (found) value = values(n)[pos];
+            }, stats);
+            return found;
+        }
+
+        bool contains(const K &key, TSXStats *stats = nullptr) {
+            V value;
+            return find(key, value, stats);
+        }
+
+        // insert: adds key if it is not in the tree yet,
+        // returns false (leaving the tree unchanged) otherwise
+        bool insert(const K &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key, value, false, stats);
+        }
+
+        // insert_or_assign: adds key or overwrites its value,
+        // returns true if key was added
+        bool insert_or_assign(const K &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key, value, true, stats);
+        }
+
+        // erase: removes key, returns false if it was not in the tree
+        bool erase(const K &key, TSXStats *stats = nullptr) {
+            bool erased = false, underfull = false;
+            atomically([&]() {
+                Node *path[MAX_DEPTH + 1];
+                int index[MAX_DEPTH + 1];
+                descend(key, path, index);
+                Node *leaf = path[depth];
+                int pos = lower_bound(leaf, key);
+                erased = found_in(leaf, pos, key);
+                if (erased) {
+                    K *k = keys(leaf);
+                    V *v = values(leaf);
+                    std::memmove(k + pos, k + pos + 1, (leaf->count - pos - 1) * sizeof(K));
+                    std::memmove(v + pos, v + pos + 1, (leaf->count - pos - 1) * sizeof(V));
+                    leaf->count--;
+                    underfull = depth > 0 && leaf->count < min_fill;
+                }
+            }, stats);
+
+            // rebalance, one step per transaction, while there is something to do
+            while (underfull) {
+                Node *freed = nullptr;
+                bool changed = false;
+                atomically([&]() {
+                    freed = nullptr;
+                    changed = rebalance(key, freed);
+                }, stats);
+                std::free(freed);
+                if (!changed) break;
+            }
+            return erased;
+        }
+
+        // range: calls fn(key, value) for every key in [lo, hi],
+        // in order. fn runs outside of any transaction.
+        // Returns the number of entries visited.
+        template <class F>
+        std::size_t range(const K &lo, const K &hi, F fn, TSXStats *stats = nullptr) {
+            std::pair<K, V> chunk[RANGE_CHUNK];
+            std::size_t visited = 0;
+            K from = lo;
+            bool inclusive = true;
+
+            for (;;) {
+                int n = 0;
+                bool more = false;
+                atomically([&]() {
+                    n = 0;
+                    more = false;
+                    Node *leaf = root;
+                    while (!leaf->leaf) leaf = children(leaf)[child_index(leaf, from)];
+                    int pos = lower_bound(leaf, from);
+                    if (!inclusive && found_in(leaf, pos, from)) pos++;
+
+                    while (leaf) {
+                        for (; pos < leaf->count; pos++) {
+                            if (less(hi, keys(leaf)[pos])) return;
+                            if (n == RANGE_CHUNK) {
+                                more = true;
+                                return;
+                            }
+                            chunk[n].first = keys(leaf)[pos];
+                            chunk[n].second = values(leaf)[pos];
+                            n++;
+                        }
+                        leaf = leaf->next;
+                        pos = 0;
+                    }
+                }, stats);
+
+                for (int i = 0; i < n; i++) fn(chunk[i].first, chunk[i].second);
+                visited += n;
+
+                if (!more) return visited;
+                from = chunk[n - 1].first;
+                inclusive = false;
+            }
+        }
+
+        // size: number of keys. Walks all the leaves
+        // in one critical section, which will usually exceed
+        // the transactional capacity and take the fall-back lock.
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t count = 0;
+            atomically([&]() {
+                count = 0;
+                Node *n = root;
+                while (!n->leaf) n = children(n)[0];
+                for (; n; n = n->next) count += n->count;
+            }, stats);
+            return count;
+        }
+
+        // verify: checks key order, separators, fill and leaf
+        // links, for tests. Must not run concurrently with updates.
+        bool verify() {
+            Node *first_leaf = nullptr;
+            Node *prev_leaf = nullptr;
+            return verify_subtree(root, 0, nullptr, nullptr, first_leaf, prev_leaf) &&
+                (prev_leaf == nullptr || prev_leaf->next == nullptr);
+        }
+
+    private:
+        bool verify_subtree(Node *n, int level, const K *lo, const K *hi,
+                            Node *&first_leaf, Node *&prev_leaf) {
+            if (n->count < 0 || n->count > fanout) return false;
+            if (level > 0 && n->count < min_fill) return false;
+            if (n->leaf != (level == depth)) return false;
+            for (int i = 0; i < n->count; i++) {
+                if (i > 0 && !less(keys(n)[i - 1], keys(n)[i])) return false;
+                if (lo && less(keys(n)[i], *lo)) return false;
+                if (hi && !less(keys(n)[i], *hi)) return false;
+            }
+            if (n->leaf) {
+                if (!first_leaf) first_leaf = n;
+                if (prev_leaf && prev_leaf->next != n) return false;
+                prev_leaf = n;
+                return true;
+            }
+            for (int i = 0; i <= n->count; i++) {
+                const K *clo = i == 0 ? lo : &keys(n)[i - 1];
+                const K *chi = i == n->count ? hi : &keys(n)[i];
+                if (!verify_subtree(children(n)[i], level + 1, clo, chi, first_leaf, prev_leaf)) return false;
+            }
+            return true;
+        }
+    };
+
+};
+
+#endif
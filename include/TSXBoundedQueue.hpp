@@ -0,0 +1,170 @@
+#ifndef INCLUDE_TSX_BOUNDED_QUEUE_HPP
+
+    #define INCLUDE_TSX_BOUNDED_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // BoundedQueue: multi-producer multi-consumer FIFO queue
+    // on a power of two ring buffer.
+    //
+    // An enqueue writes its slot and advances the tail in one
+    // TSXGuard, a dequeue reads its slot and advances the head.
+    // Producer and consumer state sit on separate ALIGNMENT sized
+    // lines. Producers keep a cached copy of the head and consumers
+    // one of the tail, refreshed only when the queue looks full
+    // (or empty), so producers and consumers only conflict on the
+    // slots themselves while the queue is neither full nor empty.
+    //
+    // The bulk operations move up to BULK_CHUNK items per
+    // transaction, amortizing _xbegin/_xend over many items.
+    // Items are copied inside transactions and must be trivially
+    // copyable.
+    template <class T>
+    class BoundedQueue {
+        static_assert(std::is_trivially_copyable<T>::value,
+        "BoundedQueue items are copied inside transactions and must be trivially copyable");
+
+    public:
+        static constexpr std::size_t BULK_CHUNK = 32;
+
+    private:
+        struct alignas(ALIGNMENT) Producer {
+            std::size_t tail;
+            std::size_t head_cache;
+        };
+
+        struct alignas(ALIGNMENT) Consumer {
+            std::size_t head;
+            std::size_t tail_cache;
+        };
+
+        Producer producer;
+        Consumer consumer;
+        alignas(ALIGNMENT) SpinLock lock;
+        T *slots;
+        const std::size_t mask;
+        const int max_retries;
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        static std::size_t round_up_pow2(std::size_t n) {
+            std::size_t size = 1;
+            while (size < n) size <<= 1;
+            return size;
+        }
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+    public:
+        // BoundedQueue: capacity is rounded up to a power of two
+        explicit BoundedQueue(std::size_t capacity, int max_tx_retries = machine_profile().max_retries):
+        slots(nullptr),
+        mask(round_up_pow2(capacity < 1 ? 1 : capacity) - 1),
+        max_retries(max_tx_retries)
+        {
+            producer.tail = producer.head_cache = 0;
+            consumer.head = consumer.tail_cache = 0;
+            void *mem = allocate_aligned(ALIGNMENT, (mask + 1) * sizeof(T));
+            slots = static_cast<T *>(mem);
+        }
+
+        ~BoundedQueue() {
+            std::free(slots);
+        }
+
+        std::size_t capacity() const { return mask + 1; }
+
+        // enqueue_bulk: appends items in order until the queue is
+        // full, returns how many were appended
+        std::size_t enqueue_bulk(const T *items, std::size_t n, TSXStats *stats = nullptr) {
+            std::size_t done = 0;
+            while (done < n) {
+                const std::size_t batch = n - done < BULK_CHUNK ? n - done : BULK_CHUNK;
+                std::size_t put = 0;
+                atomically([&]() {
+                    const std::size_t tail = producer.tail;
+                    std::size_t room = capacity() - (tail - producer.head_cache);
+                    if (room < batch) {
+                        producer.head_cache = consumer.head;
+                        room = capacity() - (tail - producer.head_cache);
+                    }
+                    put = batch < room ? batch : room;
+                    for (std::size_t i = 0; i < put; i++) slots[(tail + i) & mask] = items[done + i];
+                    producer.tail = tail + put;
+                }, stats);
+                done += put;
+                if (put < batch) break;
+            }
+            return done;
+        }
+
+        // dequeue_bulk: removes up to n items in order into out,
+        // returns how many were removed
+        std::size_t dequeue_bulk(T *out, std::size_t n, TSXStats *stats = nullptr) {
+            std::size_t done = 0;
+            while (done < n) {
+                const std::size_t batch = n - done < BULK_CHUNK ? n - done : BULK_CHUNK;
+                std::size_t got = 0;
+                atomically([&]() {
+                    const std::size_t head = consumer.head;
+                    std::size_t available = consumer.tail_cache - head;
+                    if (available < batch) {
+                        consumer.tail_cache = producer.tail;
+                        available = consumer.tail_cache - head;
+                    }
+                    got = batch < available ? batch : available;
+                    for (std::size_t i = 0; i < got; i++) out[done + i] = slots[(head + i) & mask];
+                    consumer.head = head + got;
+                }, stats);
+                done += got;
+                if (got < batch) break;
+            }
+            return done;
+        }
+
+        // enqueue: returns false if the queue is full
+        bool enqueue(const T &item, TSXStats *stats = nullptr) {
+            return enqueue_bulk(&item, 1, stats) == 1;
+        }
+
+        // dequeue: returns false if the queue is empty
+        bool dequeue(T &item, TSXStats *stats = nullptr) {
+            return dequeue_bulk(&item, 1, stats) == 1;
+        }
+
+        // size: number of queued items at some point during the call
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t count = 0;
+            atomically([&]() {
+                count = producer.tail - consumer.head;
+            }, stats);
+            return count;
+        }
+
+        bool empty(TSXStats *stats = nullptr) {
+            return size(stats) == 0;
+        }
+    };
+
+};
+
+#endif
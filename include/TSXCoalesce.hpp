@@ -0,0 +1,121 @@
+#ifndef INCLUDE_TSX_COALESCE_HPP
+
+    #define INCLUDE_TSX_COALESCE_HPP
+
+#include <cstddef>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // Coalescer: runs a sequence of small guarded sections of one
+    // thread, merging up to width() consecutive ones into a single
+    // transaction so that _xbegin, _xend and the subscription to the
+    // fall-back lock are paid once per batch instead of once per section.
+    //
+    // The width grows by one after every merged commit and halves after
+    // every abort, so it settles at the largest batch that still fits
+    // the transactional capacity and the conflict rate. At width one a
+    // section runs in its own TSXGuard, with the usual retries and the
+    // fall-back lock: batches never run under the lock, which is still
+    // taken for one section at a time. The sections of a batch commit
+    // or abort together, so each one takes effect exactly once either way.
+    //
+    // A Coalescer keeps the width of one thread, do not share it.
+    class Coalescer {
+    public:
+        static constexpr int DEFAULT_MAX_WIDTH = 32;
+
+    private:
+        SpinLock &spin_lock;
+        const int max_retries;
+        const int max_width;
+        int current;
+
+        Coalescer(const Coalescer &) = delete;
+        Coalescer &operator=(const Coalescer &) = delete;
+
+        // run_merged: sections first to first + n - 1 in one transaction,
+        // returns false if it aborted. Guards used by the sections are
+        // flattened into it like into an outermost guard.
+        template <class F>
+        bool run_merged(std::size_t first, std::size_t n, F &section) {
+            const int first_action = guard_actions().count;
+            unsigned int status = _xbegin();
+            if (status == _XBEGIN_STARTED) {
+                if (spin_lock.isLocked()) _xabort(ABORT_GL_TAKEN);
+                GuardFrame frame = { &spin_lock, false, false, nullptr };
+                innermost_guard() = &frame;
+                for (std::size_t i = first; i < first + n; i++) section(i);
+                innermost_guard() = nullptr;
+                _xend();
+                notify_waiters(spin_lock);
+                notify_joined_waiters(true);
+                run_guard_actions(first_action, true);
+                return true;
+            }
+            if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == ABORT_GL_TAKEN) {
+                while (spin_lock.isLocked()) _mm_pause();
+            }
+            return false;
+        }
+
+    public:
+        explicit Coalescer(SpinLock &mutex, int max_batch = DEFAULT_MAX_WIDTH,
+                           int max_tx_retries = machine_profile().max_retries):
+        spin_lock(mutex),
+        max_retries(max_tx_retries),
+        max_width(max_batch > 1 ? max_batch : 1),
+        current(max_width < 2 ? max_width : 2)
+        {}
+
+        // width: sections the next batch will merge
+        int width() const {
+            return current;
+        }
+
+        // run: section(i) for i from 0 to count - 1, in order, each one
+        // atomic like in a TSXGuard on the lock. The sections may use
+        // guards and on_commit, but must not abort explicitly
+        // (abort_to_retry) or call wait_until.
+        template <class F>
+        void run(std::size_t count, F section) {
+            if (innermost_guard()) {
+                // already in a guard, which the sections become part of
+                for (std::size_t i = 0; i < count; i++) section(i);
+                return;
+            }
+
+            std::size_t i = 0;
+            while (i < count) {
+                const std::size_t n = count - i < static_cast<std::size_t>(current) ?
+                    count - i : static_cast<std::size_t>(current);
+                if (n > 1) {
+                    if (run_merged(i, n, section)) {
+                        i += n;
+                        if (current < max_width) current++;
+                    } else {
+                        current /= 2;
+                    }
+                    continue;
+                }
+
+                bool speculative = false;
+                {
+                    unsigned char status = 0;
+                    TSXGuard guard(max_retries, spin_lock, status);
+                    section(i);
+                    speculative = _xtest();
+                }
+                i++;
+                // only a section that committed as a transaction
+                // shows that merging may pay off again
+                if (speculative && current < max_width) current++;
+            }
+        }
+    };
+
+};
+
+#endif
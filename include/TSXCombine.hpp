@@ -0,0 +1,218 @@
+#ifndef INCLUDE_TSX_COMBINE_HPP
+
+    #define INCLUDE_TSX_COMBINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // Combiner: a fall-back path for guarded sections based on flat
+    // combining instead of every thread queueing on the lock.
+    //
+    // execute(fn) first runs fn in a transaction, retrying like a
+    // TSXGuard. When it has to fall back, the thread publishes fn in a
+    // slot of its own and waits. One waiting thread at a time becomes
+    // the combiner and runs every published operation in one pass: in a
+    // single transaction if the batch fits, otherwise one after the
+    // other under the lock. Operations complete in a burst on the
+    // combiner's cache, and the lock line is taken once per batch
+    // instead of once per operation.
+    //
+    // A published operation runs on the combining thread, so it must not
+    // depend on thread-local state, throw, abort explicitly or wait_until.
+    // Its on_commit actions also run on the combining thread.
+    //
+    // Up to MAX_THREADS threads get a slot. A thread beyond them, while
+    // all the slots are taken, runs its fall-backs under the lock itself.
+    class Combiner: public AlignedNew<CACHE_LINE_SIZE> {
+    public:
+        static constexpr int MAX_THREADS = 128;
+
+    private:
+        enum { EMPTY, PENDING, DONE };
+
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            std::atomic<int> state;
+            void (*run)(void *);
+            void *op;
+        };
+
+        Slot slots[MAX_THREADS];
+        alignas(CACHE_LINE_SIZE) std::atomic<int> high;     // slots ever published to
+        alignas(CACHE_LINE_SIZE) SpinLock combining;
+        SpinLock &spin_lock;
+        const int max_retries;
+
+        Combiner(const Combiner &) = delete;
+        Combiner &operator=(const Combiner &) = delete;
+
+        // Index: the slot of a thread in every Combiner, handed back
+        // when the thread exits, -1 if they were all taken
+        struct Index {
+            int i;
+
+            Index(): i(-1) {
+                for (int j = 0; j < MAX_THREADS && i < 0; j++) {
+                    bool expected = false;
+                    if (!used()[j].load(std::memory_order_relaxed) &&
+                        used()[j].compare_exchange_strong(expected, true)) {
+                        i = j;
+                    }
+                }
+            }
+
+            ~Index() {
+                if (i >= 0) used()[i].store(false, std::memory_order_release);
+            }
+        };
+
+        static std::atomic<bool> *used() {
+            static std::atomic<bool> table[MAX_THREADS];
+            return table;
+        }
+
+        static int thread_index() {
+            static thread_local Index index;
+            return index.i;
+        }
+
+        template <class F>
+        static void invoke(void *op) {
+            (*static_cast<F *>(op))();
+        }
+
+        // transact: body() in one transaction, like an outermost guard,
+        // returns _XBEGIN_STARTED once committed or the abort status
+        template <class Body>
+        unsigned int transact(Body &body) {
+            const int first_action = guard_actions().count;
+            unsigned int status = _xbegin();
+            if (status == _XBEGIN_STARTED) {
+                if (spin_lock.isLocked()) _xabort(ABORT_GL_TAKEN);
+                GuardFrame frame = { &spin_lock, false, false, nullptr };
+                innermost_guard() = &frame;
+                body();
+                innermost_guard() = nullptr;
+                _xend();
+                notify_waiters(spin_lock);
+                notify_joined_waiters(true);
+                run_guard_actions(first_action, true);
+                return _XBEGIN_STARTED;
+            }
+            if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == ABORT_GL_TAKEN) {
+                while (spin_lock.isLocked()) _mm_pause();
+            }
+            return status;
+        }
+
+        // speculate: the retry policy of TSXGuard around transact,
+        // returns false where the guard would take the lock
+        template <class Body>
+        bool speculate(Body &body) {
+            int zero_aborts = 0;
+            for (int i = 0; i < max_retries; i++) {
+                unsigned int status = transact(body);
+                if (status == _XBEGIN_STARTED) return true;
+                if (status != 0) zero_aborts = 0;
+                if (status & _XABORT_EXPLICIT) {
+                    if (_XABORT_CODE(status) != ABORT_GL_TAKEN && !(status & _XABORT_RETRY)) return false;
+                } else if (status == 0 && ++zero_aborts >= PAGE_FAULT_ABORTS) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        // serialize: body() under the lock, like a guard that fell back
+        template <class Body>
+        void serialize(Body &body) {
+            const int first_action = guard_actions().count;
+            spin_lock.lock();
+            GuardFrame frame = { &spin_lock, true, false, nullptr };
+            innermost_guard() = &frame;
+            body();
+            innermost_guard() = nullptr;
+            spin_lock.unlock();
+            notify_waiters(spin_lock);
+            notify_joined_waiters(true);
+            run_guard_actions(first_action, true);
+        }
+
+        // combine: runs the operations published so far,
+        // called with combining held
+        void combine() {
+            int batch[MAX_THREADS];
+            int n = 0;
+            const int end = high.load(std::memory_order_acquire);
+            for (int i = 0; i < end; i++) {
+                if (slots[i].state.load(std::memory_order_acquire) == PENDING) batch[n++] = i;
+            }
+            // another combiner may have run this thread's operation
+            // between its last poll and winning combining
+            if (n == 0) return;
+
+            // the slots are written after the commit, a write
+            // inside it would abort on every waiter's poll
+            auto run_batch = [&]() {
+                for (int i = 0; i < n; i++) slots[batch[i]].run(slots[batch[i]].op);
+            };
+            // a lone operation has just failed to speculate on its own
+            if (n == 1 || !speculate(run_batch)) serialize(run_batch);
+            for (int i = 0; i < n; i++) slots[batch[i]].state.store(DONE, std::memory_order_release);
+        }
+
+    public:
+        explicit Combiner(SpinLock &mutex, int max_tx_retries = machine_profile().max_retries):
+        high(0),
+        spin_lock(mutex),
+        max_retries(max_tx_retries)
+        {
+            for (int i = 0; i < MAX_THREADS; i++) slots[i].state.store(EMPTY, std::memory_order_relaxed);
+        }
+
+        // execute: runs fn() atomically with respect to the other
+        // sections on the lock, returns once it has run. In a guard
+        // fn joins it, like a nested guard.
+        template <class F>
+        void execute(F fn) {
+            if (innermost_guard()) {
+                unsigned char status = 0;
+                TSXGuard guard(max_retries, spin_lock, status);
+                fn();
+                return;
+            }
+            if (speculate(fn)) return;
+
+            const int me = thread_index();
+            if (me < 0) {
+                serialize(fn);
+                return;
+            }
+            Slot &mine = slots[me];
+            mine.run = &invoke<F>;
+            mine.op = &fn;
+            mine.state.store(PENDING, std::memory_order_release);
+            int h = high.load();
+            while (h <= me && !high.compare_exchange_weak(h, me + 1)) {}
+
+            while (mine.state.load(std::memory_order_acquire) != DONE) {
+                if (combining.try_lock()) {
+                    combine();
+                    combining.unlock();
+                } else {
+                    _mm_pause();
+                }
+            }
+            mine.state.store(EMPTY, std::memory_order_relaxed);
+        }
+    };
+
+};
+
+#endif
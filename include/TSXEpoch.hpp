@@ -0,0 +1,248 @@
+#ifndef INCLUDE_TSX_EPOCH_HPP
+
+    #define INCLUDE_TSX_EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "TSXGuard.hpp"
+
+namespace TSX {
+
+    // Epoch: epoch based memory reclamation for nodes that
+    // non-transactional readers may still be looking at.
+    //
+    // A thread pins the epoch (Pin) while it may hold pointers to
+    // shared nodes. Pinning announces the global epoch in a slot of
+    // the thread's own, on a line of its own; do it before entering
+    // a guard (EpochGuard does), so the slot stays out of the
+    // transaction. A node unlinked from a structure is retired, and
+    // freed once the global epoch has moved two steps past the
+    // retirement, when no pinned thread can still reach it.
+    //
+    // Retiring inside a transaction only records the node in a small
+    // thread-local buffer: it is dropped if the transaction aborts and
+    // stamped and queued once the outermost pin is released after the
+    // commit. Queued nodes are freed in batches of RETIRE_BATCH.
+    //
+    // At most MAX_THREADS threads use the epoch at once, a further one
+    // gets std::length_error from its first pin or retire. A thread that
+    // exits with nodes still queued hands them to an orphan list, which
+    // the collections of the other threads free.
+    class Epoch {
+    public:
+        static constexpr int MAX_THREADS = 512;
+        static constexpr int RETIRE_BATCH = 64;
+        static constexpr int PENDING_MAX = 64;
+        // not a user abort code, so the guard takes the fall-back lock
+        static constexpr int ABORT_EPOCH_PENDING = USER_OPTION_LOWER_BOUND;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            std::atomic<uint64_t> announced;    // 0 when outside
+            std::atomic<bool> in_use;
+        };
+
+        struct Retired {
+            void *ptr;
+            void (*destroy)(void *);
+            uint64_t epoch;
+        };
+
+        // Local: the slot of a thread, hands it back when the thread
+        // exits and its leftover retired pointers to the orphans
+        struct Local {
+            int slot;
+            int depth;
+            int npending;
+            int since_collect;
+            Retired pending[PENDING_MAX];
+            std::vector<Retired> retired;
+
+            Local(): slot(-1), depth(0), npending(0), since_collect(0) {}
+
+            ~Local() {
+                if (slot < 0) return;
+                drain(*this);
+                try_advance();
+                collect(*this);
+                if (!retired.empty()) {
+                    orphan_lock().lock();
+                    orphans().insert(orphans().end(), retired.begin(), retired.end());
+                    norphans().store(orphans().size(), std::memory_order_release);
+                    orphan_lock().unlock();
+                }
+                slots()[slot].in_use.store(false, std::memory_order_release);
+            }
+        };
+
+        static Slot *slots() {
+            static Slot table[MAX_THREADS];
+            return table;
+        }
+
+        static std::atomic<uint64_t> &global() {
+            static std::atomic<uint64_t> epoch(1);
+            return epoch;
+        }
+
+        // orphans: retired pointers of threads that have exited
+        static std::vector<Retired> &orphans() {
+            static std::vector<Retired> list;
+            return list;
+        }
+
+        static SpinLock &orphan_lock() {
+            static SpinLock lock;
+            return lock;
+        }
+
+        static std::atomic<std::size_t> &norphans() {
+            static std::atomic<std::size_t> n(0);
+            return n;
+        }
+
+        static Local &local() {
+            static thread_local Local l;
+            if (l.slot < 0) {
+                Slot *table = slots();
+                for (int i = 0; i < MAX_THREADS && l.slot < 0; i++) {
+                    bool expected = false;
+                    if (!table[i].in_use.load(std::memory_order_relaxed) &&
+                        table[i].in_use.compare_exchange_strong(expected, true)) {
+                        l.slot = i;
+                    }
+                }
+                if (l.slot < 0) throw std::length_error("TSX::Epoch: more than MAX_THREADS threads");
+            }
+            return l;
+        }
+
+        static void try_advance() {
+            uint64_t e = global().load();
+            Slot *table = slots();
+            for (int i = 0; i < MAX_THREADS; i++) {
+                if (!table[i].in_use.load(std::memory_order_acquire)) continue;
+                uint64_t a = table[i].announced.load();
+                if (a != 0 && a != e) return;
+            }
+            global().compare_exchange_strong(e, e + 1);
+        }
+
+        static void collect(Local &l) {
+            uint64_t e = global().load();
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < l.retired.size(); i++) {
+                if (l.retired[i].epoch + 2 <= e) l.retired[i].destroy(l.retired[i].ptr);
+                else l.retired[kept++] = l.retired[i];
+            }
+            l.retired.resize(kept);
+            if (norphans().load(std::memory_order_acquire)) adopt(e);
+        }
+
+        // adopt: frees the orphans retired two epochs before e,
+        // unless another thread is at it already
+        static void adopt(uint64_t e) {
+            if (!orphan_lock().try_lock()) return;
+            std::vector<Retired> &list = orphans();
+            std::vector<Retired> ready;
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < list.size(); i++) {
+                if (list[i].epoch + 2 <= e) ready.push_back(list[i]);
+                else list[kept++] = list[i];
+            }
+            list.resize(kept);
+            norphans().store(kept, std::memory_order_release);
+            orphan_lock().unlock();
+            for (std::size_t i = 0; i < ready.size(); i++) ready[i].destroy(ready[i].ptr);
+        }
+
+        static void queue(Local &l, void *ptr, void (*destroy)(void *)) {
+            Retired r = { ptr, destroy, global().load() };
+            l.retired.push_back(r);
+            if (++l.since_collect >= RETIRE_BATCH) {
+                l.since_collect = 0;
+                try_advance();
+                collect(l);
+            }
+        }
+
+        // drain: queues the nodes retired in committed transactions
+        static void drain(Local &l) {
+            for (int i = 0; i < l.npending; i++) queue(l, l.pending[i].ptr, l.pending[i].destroy);
+            l.npending = 0;
+        }
+
+    public:
+        // Pin: keeps nodes retired from now on alive
+        // until the pin is dropped. Pins nest.
+        class Pin {
+        public:
+            Pin() {
+                Local &l = local();
+                if (l.depth++ == 0) slots()[l.slot].announced.store(global().load());
+            }
+
+            ~Pin() {
+                Local &l = local();
+                if (--l.depth == 0) {
+                    slots()[l.slot].announced.store(0, std::memory_order_release);
+                    if (l.npending && !_xtest()) drain(l);
+                }
+            }
+
+            Pin(const Pin &) = delete;
+            Pin &operator=(const Pin &) = delete;
+        };
+
+        // retire: ptr has been unlinked, destroy(ptr) once no pinned
+        // thread can reach it. In a transaction, aborts it with
+        // ABORT_EPOCH_PENDING if PENDING_MAX nodes are already recorded.
+        static void retire(void *ptr, void (*destroy)(void *)) {
+            Local &l = local();
+            if (_xtest()) {
+                if (l.npending == PENDING_MAX) _xabort(ABORT_EPOCH_PENDING);
+                Retired &r = l.pending[l.npending++];
+                r.ptr = ptr;
+                r.destroy = destroy;
+                return;
+            }
+            if (l.npending) drain(l);
+            queue(l, ptr, destroy);
+        }
+
+        template <class T>
+        static void retire(T *ptr) {
+            retire(ptr, [](void *p) { delete static_cast<T *>(p); });
+        }
+
+        // flush: queues what was retired in transactions and frees what
+        // can be freed already. Call it outside transactions.
+        static void flush() {
+            Local &l = local();
+            drain(l);
+            try_advance();
+            collect(l);
+        }
+    };
+
+    // EpochGuard: a TSXGuard that pins the epoch before it begins
+    // and releases the pin after the commit or the unlock
+    class EpochGuard: private Epoch::Pin, public TSXGuard {
+    public:
+        EpochGuard(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status):
+        Epoch::Pin(),
+        TSXGuard(max_tx_retries, mutex, err_status) {}
+
+        template <class WarmUp>
+        EpochGuard(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status, WarmUp warm_up):
+        Epoch::Pin(),
+        TSXGuard(max_tx_retries, mutex, err_status, warm_up) {}
+    };
+
+};
+
+#endif
@@ -3,16 +3,32 @@
     #define INCLUDE_TSX_GUARD_HPP
 
 #include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include <climits>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include "rtm.h"
 #include "emmintrin.h"
 #include "iostream"
 
 namespace TSX {
     static constexpr int ALIGNMENT = 128;
+    static constexpr int CACHE_LINE_SIZE = 64;  // granularity of transactional conflict tracking
     static constexpr int ABORT_VALIDATION_FAILURE = 0xee;
     static constexpr int ABORT_GL_TAKEN = 0;
     static constexpr int USER_OPTION_LOWER_BOUND = 0x01;
+    static constexpr int ABORT_WAIT = 0xef;         // wait_until, handled by the guards
+    static constexpr int PAGE_FAULT_ABORTS = 3;     // aborts without a reason taken for a page fault
 
     class SpinLock {
         private:
@@ -39,6 +55,10 @@ namespace TSX {
                 }
             }
 
+            bool try_lock() noexcept {
+                return spin_lock.load(std::memory_order_relaxed) == UNLOCKED && !spin_lock.exchange(LOCKED);
+            }
+
             void unlock() noexcept{
                 spin_lock.store(false);
             }
@@ -49,6 +69,92 @@ namespace TSX {
 
     };
 
+    // allocate_aligned: bytes bytes on an align boundary,
+    // throws std::bad_alloc on failure. Free with std::free.
+    inline void *allocate_aligned(std::size_t align, std::size_t bytes) {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, align, bytes) != 0) throw std::bad_alloc();
+        return mem;
+    }
+
+    // AlignedNew: base for classes aligned to more than the default,
+    // whose alignment plain new does not honor before C++17
+    template <std::size_t Align>
+    struct AlignedNew {
+        static void *operator new(std::size_t bytes) { return allocate_aligned(Align, bytes); }
+        static void *operator new[](std::size_t bytes) { return allocate_aligned(Align, bytes); }
+        static void operator delete(void *mem) { std::free(mem); }
+        static void operator delete[](void *mem) { std::free(mem); }
+    };
+
+    // PaddedTo: a T that starts on an Align boundary and has its
+    // Align bytes to itself, so that writes to neighbouring data do
+    // not abort the transactions that read it. operator new honors the
+    // alignment, std::allocator (and so std::vector) does not before C++17.
+    template <class T, std::size_t Align>
+    struct alignas(Align) PaddedTo: AlignedNew<Align> {
+        T value;
+
+        PaddedTo(): value() {}
+
+        template <class A, class... Args>
+        explicit PaddedTo(A &&a, Args &&... args): value(std::forward<A>(a), std::forward<Args>(args)...) {}
+
+        T &operator*() { return value; }
+        const T &operator*() const { return value; }
+        T *operator->() { return &value; }
+        const T *operator->() const { return &value; }
+    };
+
+    // Padded: alone on ALIGNMENT bytes, which also keeps the adjacent
+    // line prefetcher from pairing it with its neighbours
+    template <class T>
+    using Padded = PaddedTo<T, ALIGNMENT>;
+
+    // CacheAligned: alone on its cache lines
+    template <class T>
+    using CacheAligned = PaddedTo<T, CACHE_LINE_SIZE>;
+
+    // PaddedSpinLock: a SpinLock that can be embedded next to the data
+    // it guards. Transactions read the lock through isLocked(), so a
+    // write to anything on its line would abort all of them.
+    class alignas(ALIGNMENT) PaddedSpinLock: public SpinLock, public AlignedNew<ALIGNMENT> {};
+
+    static_assert(sizeof(PaddedSpinLock) == ALIGNMENT, "PaddedSpinLock should fill ALIGNMENT bytes");
+
+    // shares_cache_line: whether bytes [a, a + a_size) and [b, b + b_size)
+    // of an object aligned to object_align can fall on a common cache line.
+    // Without line alignment it depends on where the object is placed,
+    // so any two ranges less than a line apart count.
+    constexpr bool shares_cache_line(std::size_t object_align, std::size_t a, std::size_t a_size,
+                                     std::size_t b, std::size_t b_size) {
+        return b < a ? shares_cache_line(object_align, b, b_size, a, a_size)
+             : object_align % CACHE_LINE_SIZE == 0
+                ? a / CACHE_LINE_SIZE <= (b + b_size - 1) / CACHE_LINE_SIZE &&
+                  b / CACHE_LINE_SIZE <= (a + a_size - 1) / CACHE_LINE_SIZE
+                : b < a + a_size || b - (a + a_size) < CACHE_LINE_SIZE - 1;
+    }
+
+    // TSX_ASSERT_SEPARATE_LINES(Type, lock, data): fails to compile when
+    // the members lock and data of the standard layout Type can share a
+    // cache line, i.e. when writing data aborts transactions on lock.
+    #define TSX_ASSERT_SEPARATE_LINES(Type, a, b) \
+        static_assert(!TSX::shares_cache_line(alignof(Type), offsetof(Type, a), sizeof(Type::a), \
+                                              offsetof(Type, b), sizeof(Type::b)), \
+                      #a " and " #b " of " #Type " share a cache line")
+
+    // mix_hash: spreads the bits of a hash over all 64 (the murmur3
+    // finalizer), std::hash is the identity for integers and strided
+    // keys would pile up in a few buckets of a power of two table
+    inline uint64_t mix_hash(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
     enum {
 	TX_ABORT_CONFLICT = 0,
 	TX_ABORT_CAPACITY,
@@ -91,7 +197,7 @@ namespace TSX {
     };
 
 
-    TSXStats total_stats(std::vector<TSXStats> stats) {
+    inline TSXStats total_stats(std::vector<TSXStats> stats) {
         TSXStats total_stats;
 
         for (auto i = stats.begin(); i != stats.end(); i++) {
@@ -110,6 +216,275 @@ namespace TSX {
     }
 
 
+    // prefault: maps in the pages of [addr, addr + len) writable
+    // without changing their contents. A page fault cannot be serviced
+    // inside a transaction, which aborts without a reason and faults
+    // again on every retry.
+    inline void prefault(void *addr, std::size_t len) {
+        if (len == 0) return;
+        const uintptr_t page = sysconf(_SC_PAGESIZE);
+        const uintptr_t first = reinterpret_cast<uintptr_t>(addr);
+        const uintptr_t begin = first & ~(page - 1);
+        const uintptr_t end = first + len;
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+#ifdef MADV_POPULATE_WRITE
+        if (madvise(reinterpret_cast<void *>(begin), end - begin, MADV_POPULATE_WRITE) == 0) return;
+#endif
+        // older kernels: an atomic no-op write to every page
+        for (uintptr_t p = first; p < end; p = (p & ~(page - 1)) + page) {
+            __atomic_fetch_add(reinterpret_cast<char *>(p), 0, __ATOMIC_RELAXED);
+        }
+    }
+
+    // PrefaultScope: registers [addr, addr + len) with the guards of
+    // this thread while in scope. After PAGE_FAULT_ABORTS aborts in a
+    // row without a reason, a guard pre-faults the registered regions
+    // once and retries, and takes the fall-back lock if the aborts go
+    // on after that. Interrupts abort without a reason too, so with
+    // nothing registered the guard just spends its retries as usual.
+    class PrefaultScope {
+    public:
+        static constexpr int MAX_REGIONS = 16;
+
+    private:
+        struct Region {
+            void *addr;
+            std::size_t len;
+        };
+
+        struct Registry {
+            Region regions[MAX_REGIONS];
+            int count;      // may exceed MAX_REGIONS, the rest are ignored
+        };
+
+        static Registry &registry() {
+            static thread_local Registry r;
+            return r;
+        }
+
+    public:
+        PrefaultScope(void *addr, std::size_t len) {
+            Registry &r = registry();
+            if (r.count < MAX_REGIONS) {
+                r.regions[r.count].addr = addr;
+                r.regions[r.count].len = len;
+            }
+            r.count++;
+        }
+
+        ~PrefaultScope() {
+            registry().count--;
+        }
+
+        PrefaultScope(const PrefaultScope &) = delete;
+        PrefaultScope &operator=(const PrefaultScope &) = delete;
+
+        // prefault_all: pre-faults the regions registered by
+        // this thread, false if there are none
+        static bool prefault_all() {
+            Registry &r = registry();
+            const int n = r.count < MAX_REGIONS ? r.count : MAX_REGIONS;
+            for (int i = 0; i < n; i++) prefault(r.regions[i].addr, r.regions[i].len);
+            return n > 0;
+        }
+    };
+
+    // NoWarmUp: the default guard warm-up, does nothing
+    struct NoWarmUp {
+        void operator()() const {}
+    };
+
+    // Prefetch: a guard warm-up that pulls the given addresses into
+    // the cache before every attempt, so that the transaction does not
+    // wait on misses and stays open for less time. For writing it
+    // requests the lines exclusive (PREFETCHW where the target has it,
+    // e.g. -mprfchw), for reading shared. The addresses are not copied.
+    class Prefetch {
+        const void *const *addrs;
+        std::size_t count;
+        bool for_write;
+    public:
+        Prefetch(const void *const *addresses, std::size_t n, bool write = true):
+        addrs(addresses), count(n), for_write(write) {}
+
+        template <std::size_t N>
+        explicit Prefetch(const void *const (&addresses)[N], bool write = true):
+        addrs(addresses), count(N), for_write(write) {}
+
+        void operator()() const {
+            if (for_write) {
+                for (std::size_t i = 0; i < count; i++) __builtin_prefetch(addrs[i], 1, 3);
+            } else {
+                for (std::size_t i = 0; i < count; i++) __builtin_prefetch(addrs[i], 0, 3);
+            }
+        }
+    };
+
+    // WaitWord: what guards blocked in wait_until sleep on. Every lock
+    // hashes to one; a guard that commits or unlocks bumps its version
+    // and wakes the sleepers, but only if there are any, so guards
+    // without waiters do nothing but read waiters after they end.
+    struct alignas(CACHE_LINE_SIZE) WaitWord {
+        std::atomic<uint32_t> version;
+        std::atomic<uint32_t> waiters;
+    };
+
+    static constexpr int WAIT_WORDS = 64;
+
+    inline WaitWord *wait_words() {
+        static WaitWord words[WAIT_WORDS];
+        return words;
+    }
+
+    inline int wait_word_index(const SpinLock &lock) {
+        return (reinterpret_cast<uintptr_t>(&lock) * 0x9E3779B97F4A7C15ull) >> 58;
+    }
+
+    inline WaitWord &wait_word(const SpinLock &lock) {
+        return wait_words()[wait_word_index(lock)];
+    }
+
+    // park: sleeps until the version of w is no longer seen
+    inline void park(WaitWord &w, uint32_t seen) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.version), FUTEX_WAIT_PRIVATE, seen,
+                nullptr, nullptr, 0);
+    }
+
+    inline void notify_word(WaitWord &w) {
+        if (w.waiters.load() == 0) return;
+        w.version.fetch_add(1);
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.version), FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+    }
+
+    inline void notify_waiters(const SpinLock &lock) {
+        notify_word(wait_word(lock));
+    }
+
+    // joined_wait_words: a bit per WaitWord of the locks that flattened
+    // guards joined without taking them. What they wrote becomes visible
+    // when the outermost section commits, so that is when they are woken.
+    // Set in the transaction, the bits are rolled back with it.
+    inline uint64_t &joined_wait_words() {
+        static thread_local uint64_t words = 0;
+        return words;
+    }
+
+    inline void join_wait_word(const SpinLock &lock) {
+        uint64_t &words = joined_wait_words();
+        const uint64_t bit = 1ull << wait_word_index(lock);
+        // reading before writing keeps the line out of the write set
+        if (!(words & bit)) words |= bit;
+    }
+
+    // notify_joined_waiters: called once an outermost section has
+    // ended, wakes the waiters of the joined locks if it committed
+    inline void notify_joined_waiters(bool committed) {
+        uint64_t words = joined_wait_words();
+        if (!words) return;
+        joined_wait_words() = 0;
+        for (int i = 0; committed && i < WAIT_WORDS; i++) {
+            if (words >> i & 1) notify_word(wait_words()[i]);
+        }
+    }
+
+    // GuardActions: callables registered with on_commit or on_abort
+    // in the guards of a thread, run once the outermost guard ends.
+    // Registering only writes this thread-local buffer, so in a
+    // transaction it is rolled back with everything else on an abort
+    // and registered again by the retry.
+    static constexpr int MAX_GUARD_ACTIONS = 16;
+    static constexpr std::size_t GUARD_ACTION_BYTES = 32;
+
+    struct GuardAction {
+        void (*run)(const void *);
+        bool on_commit;
+        std::aligned_storage<GUARD_ACTION_BYTES>::type storage;
+    };
+
+    struct GuardActions {
+        int count;
+        GuardAction actions[MAX_GUARD_ACTIONS];
+    };
+
+    inline GuardActions &guard_actions() {
+        static thread_local GuardActions actions;
+        return actions;
+    }
+
+    // add_guard_action: a full buffer aborts a transaction to the
+    // fall-back lock, and throws std::length_error under it
+    template <class F>
+    void add_guard_action(const F &fn, bool on_commit) {
+        static_assert(sizeof(F) <= GUARD_ACTION_BYTES, "Guard actions are limited to GUARD_ACTION_BYTES");
+        static_assert(std::is_trivially_copyable<F>::value, "Guard actions must be trivially copyable");
+        GuardActions &a = guard_actions();
+        if (a.count == MAX_GUARD_ACTIONS) {
+            if (_xtest()) _xabort(USER_OPTION_LOWER_BOUND);
+            throw std::length_error("too many guard actions");
+        }
+        GuardAction &action = a.actions[a.count++];
+        action.run = [](const void *stored) {
+            F f = *static_cast<const F *>(stored);
+            f();
+        };
+        action.on_commit = on_commit;
+        new (&action.storage) F(fn);
+    }
+
+    // run_guard_actions: runs the actions registered since
+    // first for a section that did or did not commit
+    inline void run_guard_actions(int first, bool committed) {
+        GuardActions &a = guard_actions();
+        // actions may use guards themselves, which add past count
+        for (int i = first; i < a.count; i++) {
+            if (a.actions[i].on_commit == committed) a.actions[i].run(&a.actions[i].storage);
+        }
+        a.count = first;
+    }
+
+    // GuardFrame: a guard the thread is in. A guard constructed inside
+    // another one is flattened into it: it does not begin a transaction
+    // of its own, an abort in it aborts the outermost transaction, and
+    // it only takes its lock if no enclosing guard holds it already
+    // (taking it again would deadlock). A flattened guard that took its
+    // lock wakes its waiters when it unlocks it, otherwise the outermost
+    // section does (see joined_wait_words).
+    struct GuardFrame {
+        SpinLock *lock;
+        bool locked;        // holds lock, not transactional
+        bool abandoned;     // abort_to_retry in a nested guard under the lock
+        GuardFrame *outer;
+    };
+
+    inline GuardFrame *&innermost_guard() {
+        static thread_local GuardFrame *frame = nullptr;
+        return frame;
+    }
+
+    // abandon_outermost_guard: outside a transaction _xabort does
+    // nothing, so an abort in a flattened guard under the lock marks
+    // the outermost frame, which then ends as abandoned
+    inline void abandon_outermost_guard(GuardFrame *frame) {
+        while (frame->outer) frame = frame->outer;
+        frame->abandoned = true;
+    }
+
+    // join_enclosing_guard: makes a flattened guard on lock safe,
+    // returns whether it had to take the lock
+    inline bool join_enclosing_guard(SpinLock &lock) {
+        if (_xtest()) {
+            // the enclosing transaction has to see this lock free as well
+            if (lock.isLocked()) _xabort(ABORT_GL_TAKEN);
+            return false;
+        }
+        for (GuardFrame *f = innermost_guard(); f; f = f->outer) {
+            if (f->lock == &lock && f->locked) return false;
+        }
+        lock.lock();
+        return true;
+    }
+
     // TSXGuard works similarly to std::lock_guard
     // but uses hardware transactional memory to 
     // achieve synchronization. The result is the
@@ -125,25 +500,87 @@ namespace TSX {
                                         // transaction not pending
         int nretries;           // how many retries have been made so far
                                 // used to resume transaction in case of user abort
+        bool flattened;         // inside another guard of this thread
+        bool entered;           // frame is the thread's innermost guard
+        bool waiting;           // counted in the waiters of the lock's WaitWord
+        int first_action;       // of this guard in guard_actions()
+        GuardFrame frame;
+
+        void enter() {
+            frame.lock = &spin_lock;
+            frame.locked = has_locked;
+            frame.abandoned = false;
+            frame.outer = innermost_guard();
+            innermost_guard() = &frame;
+            entered = true;
+        }
+
+        // wait: the transaction found the predicate of wait_until
+        // false. The first time the guard only registers as a waiter
+        // and retries, so that a commit after the retry read the
+        // predicate is sure to see the waiter and wake it.
+        void wait(uint32_t &seen) {
+            WaitWord &w = wait_word(spin_lock);
+            if (!waiting) {
+                waiting = true;
+                w.waiters.fetch_add(1);
+            } else {
+                park(w, seen);
+            }
+            seen = w.version.load();
+        }
     public:
-        TSXGuard(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status): 
+        TSXGuard(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status):
+        TSXGuard(max_tx_retries, mutex, err_status, NoWarmUp()) {}
+
+        // warm_up() runs before every attempt to start the
+        // transaction, e.g. a Prefetch of the lines it will touch
+        template <class WarmUp>
+        TSXGuard(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status, WarmUp warm_up):
         max_retries(max_tx_retries),
         spin_lock(mutex),
         has_locked(false),
         user_explicitly_aborted(false),
-        nretries(0)
+        nretries(0),
+        flattened(false),
+        entered(false),
+        waiting(false),
+        first_action(0)
         {
+            if (innermost_guard()) {
+                flattened = true;
+                has_locked = join_enclosing_guard(spin_lock);
+                if (!has_locked) join_wait_word(spin_lock);
+                enter();
+                return;
+            }
+
+            first_action = guard_actions().count;
+            int zero_aborts = 0;
+            bool prefaulted = false;
+            uint32_t seen = 0;
             while(1) {
 
                 ++nretries;
-                
+                warm_up();
+
                 // try to init transaction
                 unsigned int status = _xbegin();
+                // only aborts without a reason in a row hint at a page fault
+                if (status != 0) zero_aborts = 0;
                 if (status == _XBEGIN_STARTED) {      // tx started
-                    if (!spin_lock.isLocked()) return; //successfully started transaction
+                    if (!spin_lock.isLocked()) { //successfully started transaction
+                        enter();
+                        return;
+                    }
                     // started txn but someone is executing the txn  section non-speculatively
                     // (acquired the  fall-back lock) -> aborting
                     _xabort(ABORT_GL_TAKEN); // abort with code 0xff  
+                } else if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == ABORT_WAIT) {
+                    // see wait_until, waiting is not a failed attempt
+                    --nretries;
+                    wait(seen);
+                    continue;
                 } else if (status & _XABORT_EXPLICIT) {
                     if (_XABORT_CODE(status) == ABORT_GL_TAKEN && !(status & _XABORT_NESTED)) {
                         while (spin_lock.isLocked()) _mm_pause();
@@ -156,7 +593,12 @@ namespace TSX {
                         // go to the fallback immediately
                         goto fallback_lock; 
                     } 
-                } 
+                } else if (status == 0 && ++zero_aborts >= PAGE_FAULT_ABORTS) {
+                    // most likely a page fault, see PrefaultScope
+                    if (prefaulted) goto fallback_lock;
+                    prefaulted = PrefaultScope::prefault_all();
+                    zero_aborts = 0;
+                }
 
                 // too many retries, take the fall-back lock 
                 if (nretries >= max_retries) break;
@@ -165,19 +607,63 @@ namespace TSX {
     fallback_lock:
                 has_locked = true;
                 spin_lock.lock();
+                enter();
+        }
+
+        // wait_until: returns once pred() holds. In a transaction
+        // a false predicate aborts it, the guard sleeps until another
+        // guard on the same lock commits or unlocks and then retries.
+        // Under the fall-back lock it waits like on a condition
+        // variable, releasing the lock while asleep, so call it before
+        // the section writes anything. Only the outermost guard may
+        // wait: a nested one would sleep on the wrong lock.
+        template <class Pred>
+        void wait_until(Pred pred) {
+            assert(!flattened && "wait_until in a nested guard");
+            if (pred()) return;
+            if (_xtest()) _xabort(ABORT_WAIT);
+
+            WaitWord &w = wait_word(spin_lock);
+            w.waiters.fetch_add(1);
+            while (!pred()) {
+                uint32_t seen = w.version.load();
+                spin_lock.unlock();
+                park(w, seen);
+                spin_lock.lock();
+            }
+            w.waiters.fetch_sub(1);
+        }
+
+        // on_commit: fn() runs once after the outermost guard commits
+        // or unlocks. For side effects (I/O, free, notifications) that
+        // would abort the transaction or repeat on every retry.
+        template <class F>
+        void on_commit(F fn) {
+            add_guard_action(fn, true);
+        }
+
+        // on_abort: fn() runs if the section is abandoned after it ran
+        // under the fall-back lock (abort_to_retry), to compensate for
+        // what it did there. A transactional abort needs no compensation
+        // and drops fn with the rest of the transaction.
+        template <class F>
+        void on_abort(F fn) {
+            add_guard_action(fn, false);
         }
 
         // abort_to_retry: aborts current transaction
         // and returns retries left
         // in order to retry transaction.
         // Takes the error code as a template
-        // parameter.
+        // parameter. In a nested guard under the lock
+        // it abandons the outermost section.
         template <unsigned char imm>
         int abort_to_retry() {
             static_assert(imm > USER_OPTION_LOWER_BOUND, 
             "User aborts should be larger than USER_OPTION_LOWER_BOUND, as lower numbers are reserved");
             _xabort(imm);
             user_explicitly_aborted = true;
+            if (flattened) abandon_outermost_guard(&frame);
             return max_retries - nretries;
         }
 
@@ -193,14 +679,24 @@ namespace TSX {
 
 
         ~TSXGuard() {
-            if (!user_explicitly_aborted) {
-                // no abort code
-                if (has_locked && spin_lock.isLocked()) {
+            if (entered) innermost_guard() = frame.outer;
+            if (flattened) {
+                if (has_locked) {
                     spin_lock.unlock();
-                } else {
-                    _xend();
+                    notify_waiters(spin_lock);
                 }
+                return;
             }
+            const bool committed = !user_explicitly_aborted && !(entered && frame.abandoned);
+            if (has_locked && spin_lock.isLocked()) {
+                spin_lock.unlock();
+            } else if (committed) {
+                _xend();
+            }
+            if (committed) notify_waiters(spin_lock);
+            notify_joined_waiters(committed);
+            run_guard_actions(first_action, committed);
+            if (waiting) wait_word(spin_lock).waiters.fetch_sub(1);
             
         }     
     };
@@ -215,26 +711,82 @@ namespace TSX {
                                         // transaction not pending
         int nretries;           // how many retries have been made so far
                                 // used to resume transaction in case of user abort
+        bool flattened;         // inside another guard of this thread
+        bool entered;           // frame is the thread's innermost guard
+        bool waiting;           // counted in the waiters of the lock's WaitWord
+        int first_action;       // of this guard in guard_actions()
+        GuardFrame frame;
+
+        void enter() {
+            frame.lock = &spin_lock;
+            frame.locked = has_locked;
+            frame.abandoned = false;
+            frame.outer = innermost_guard();
+            innermost_guard() = &frame;
+            entered = true;
+        }
+
+        // wait: the transaction found the predicate of wait_until
+        // false. The first time the guard only registers as a waiter
+        // and retries, so that a commit after the retry read the
+        // predicate is sure to see the waiter and wake it.
+        void wait(uint32_t &seen) {
+            WaitWord &w = wait_word(spin_lock);
+            if (!waiting) {
+                waiting = true;
+                w.waiters.fetch_add(1);
+            } else {
+                park(w, seen);
+            }
+            seen = w.version.load();
+        }
         TSXStats &_stats;
     public:
         TSXGuardWithStats(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status, TSXStats &stats):
+        TSXGuardWithStats(max_tx_retries, mutex, err_status, stats, NoWarmUp()) {}
+
+        template <class WarmUp>
+        TSXGuardWithStats(const int max_tx_retries, SpinLock &mutex, unsigned char &err_status, TSXStats &stats,
+                          WarmUp warm_up):
         max_retries(max_tx_retries),
         spin_lock(mutex),
         has_locked(false),
         user_explicitly_aborted(false),
         nretries(0),
+        flattened(false),
+        entered(false),
+        waiting(false),
+        first_action(0),
         _stats(stats)
         {
+            if (innermost_guard()) {
+                flattened = true;
+                has_locked = join_enclosing_guard(spin_lock);
+                if (!has_locked) join_wait_word(spin_lock);
+                enter();
+                return;
+            }
+
+            first_action = guard_actions().count;
+            int zero_aborts = 0;
+            bool prefaulted = false;
+            uint32_t seen = 0;
             while(1) {
 
 
                 ++nretries;
-                
+                warm_up();
+
                 // try to init transaction
                 unsigned int status = _xbegin();
+                // only aborts without a reason in a row hint at a page fault
+                if (status != 0) zero_aborts = 0;
                 if (status == _XBEGIN_STARTED) {   // tx started
                     _stats.tx_starts++;
-                    if (!spin_lock.isLocked()) return;  //successfully started transaction
+                    if (!spin_lock.isLocked()) {    //successfully started transaction
+                        enter();
+                        return;
+                    }
                     
                     // started txn but someone is executing the txn  section non-speculatively 
                     // (acquired the  fall-back lock) -> aborting
@@ -246,6 +798,11 @@ namespace TSX {
                 } else if (status & _XABORT_CONFLICT) {
                     _stats.tx_aborts++;
                     _stats.tx_aborts_per_reason[TX_ABORT_CONFLICT]++;
+                } else if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == ABORT_WAIT) {
+                    // see wait_until, waiting is not a failed attempt
+                    --nretries;
+                    wait(seen);
+                    continue;
                 } else if (status & _XABORT_EXPLICIT) {
                      _stats.tx_aborts++;
                      _stats.tx_aborts_per_reason[TX_ABORT_EXPLICIT]++;
@@ -265,6 +822,15 @@ namespace TSX {
                     } else {
                         _stats.tx_aborts_per_reason[TX_ABORT_REST]++;
                     }   
+                } else if (status == 0) {
+                    _stats.tx_aborts++;
+                    _stats.tx_aborts_per_reason[TX_ABORT_REST]++;
+                    // most likely a page fault, see PrefaultScope
+                    if (++zero_aborts >= PAGE_FAULT_ABORTS) {
+                        if (prefaulted) goto fallback_lock;
+                        prefaulted = PrefaultScope::prefault_all();
+                        zero_aborts = 0;
+                    }
                 }
                 
                  
@@ -276,18 +842,62 @@ namespace TSX {
                 _stats.tx_lacqs++;
                 has_locked = true;
                 spin_lock.lock();
+                enter();
+        }
+        // wait_until: returns once pred() holds. In a transaction
+        // a false predicate aborts it, the guard sleeps until another
+        // guard on the same lock commits or unlocks and then retries.
+        // Under the fall-back lock it waits like on a condition
+        // variable, releasing the lock while asleep, so call it before
+        // the section writes anything. Only the outermost guard may
+        // wait: a nested one would sleep on the wrong lock.
+        template <class Pred>
+        void wait_until(Pred pred) {
+            assert(!flattened && "wait_until in a nested guard");
+            if (pred()) return;
+            if (_xtest()) _xabort(ABORT_WAIT);
+
+            WaitWord &w = wait_word(spin_lock);
+            w.waiters.fetch_add(1);
+            while (!pred()) {
+                uint32_t seen = w.version.load();
+                spin_lock.unlock();
+                park(w, seen);
+                spin_lock.lock();
+            }
+            w.waiters.fetch_sub(1);
+        }
+
+        // on_commit: fn() runs once after the outermost guard commits
+        // or unlocks. For side effects (I/O, free, notifications) that
+        // would abort the transaction or repeat on every retry.
+        template <class F>
+        void on_commit(F fn) {
+            add_guard_action(fn, true);
+        }
+
+        // on_abort: fn() runs if the section is abandoned after it ran
+        // under the fall-back lock (abort_to_retry), to compensate for
+        // what it did there. A transactional abort needs no compensation
+        // and drops fn with the rest of the transaction.
+        template <class F>
+        void on_abort(F fn) {
+            add_guard_action(fn, false);
         }
+
         // abort_to_retry: aborts current transaction
         // and returns retries left
         // in order to retry transaction.
         // Takes the error code as a template
-        // parameter.
+        // parameter. In a nested guard under the lock
+        // it abandons the outermost section.
         template <unsigned char imm>
         int abort_to_retry() {
             static_assert(imm > USER_OPTION_LOWER_BOUND, 
             "User aborts should be larger than USER_OPTION_LOWER_BOUND, as lower numbers are reserved");
             _xabort(imm);
             user_explicitly_aborted = true;
+            if (flattened) abandon_outermost_guard(&frame);
             return max_retries - nretries;
         }
 
@@ -302,15 +912,25 @@ namespace TSX {
         }
 
         ~TSXGuardWithStats() {
-            if (!user_explicitly_aborted) {
-                // no abort code
-                if (has_locked && spin_lock.isLocked()) {
+            if (entered) innermost_guard() = frame.outer;
+            if (flattened) {
+                if (has_locked) {
                     spin_lock.unlock();
-                } else {
-                    _stats.tx_commits++;
-                    _xend();
+                    notify_waiters(spin_lock);
                 }
+                return;
+            }
+            const bool committed = !user_explicitly_aborted && !(entered && frame.abandoned);
+            if (has_locked && spin_lock.isLocked()) {
+                spin_lock.unlock();
+            } else if (committed) {
+                _stats.tx_commits++;
+                _xend();
             }
+            if (committed) notify_waiters(spin_lock);
+            notify_joined_waiters(committed);
+            run_guard_actions(first_action, committed);
+            if (waiting) wait_word(spin_lock).waiters.fetch_sub(1);
             
         }     
         
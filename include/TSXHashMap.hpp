@@ -0,0 +1,379 @@
+#ifndef INCLUDE_TSX_HASH_MAP_HPP
+
+    #define INCLUDE_TSX_HASH_MAP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // HashMap: concurrent hash map whose operations
+    // run inside TSXGuards.
+    //
+    // Open addressing over buckets that fill one ALIGNMENT
+    // block each, probing bucket by bucket, so a lookup
+    // usually reads a single bucket and two operations only
+    // conflict if their keys share a bucket.
+    // Nothing is allocated inside a transaction: tables are
+    // allocated before the guard is taken and freed after
+    // it is released.
+    //
+    // Resizing is incremental. A resize only installs the
+    // new table, after that every insert and erase moves a
+    // few buckets of the old table over in a separate small
+    // transaction, so a resize never turns into one
+    // transaction that aborts on capacity.
+    //
+    // Keys and values are copied inside transactions and
+    // must be trivially copyable.
+    template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K> >
+    class HashMap {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "HashMap keys and values are copied inside transactions and must be trivially copyable");
+
+    private:
+        static constexpr int FIT = (ALIGNMENT - 8) / static_cast<int>(sizeof(K) + sizeof(V));
+        static constexpr int SLOTS = FIT < 1 ? 1 : (FIT > 16 ? 16 : FIT);
+        static constexpr int MAX_PROBE = 8;         // buckets probed by an insert before resizing
+        static constexpr int MIGRATE_BATCH = 2;     // old buckets moved per migration step
+        static constexpr int COUNTERS = 16;
+
+        struct alignas(ALIGNMENT) Bucket {
+            uint16_t used;          // slot holds an entry
+            uint16_t deleted;       // slot held an entry, probing continues past it
+            K keys[SLOTS];
+            V values[SLOTS];
+        };
+
+        struct Table {
+            std::size_t mask;       // buckets - 1
+            Bucket *buckets;
+            bool tombstones;        // an entry was erased from it
+            bool rehashed;          // same size copy of the table before it
+        };
+
+        struct alignas(ALIGNMENT) Counter {
+            std::atomic<long> value;
+        };
+
+        struct alignas(ALIGNMENT) Migration {
+            std::size_t next;       // first bucket of old not moved yet
+        };
+
+        // read by every operation, written only by resizes
+        alignas(ALIGNMENT) std::atomic<Table *> current;
+        std::atomic<Table *> old;
+
+        Migration migration;
+        Counter counters[COUNTERS];
+        SpinLock lock;
+        const int max_retries;
+
+        Hash hasher;
+        KeyEqual equal;
+
+        HashMap(const HashMap &) = delete;
+        HashMap &operator=(const HashMap &) = delete;
+
+        uint64_t hash(const K &key) const {
+            return mix_hash(hasher(key));
+        }
+
+        static Table *allocate(std::size_t nbuckets) {
+            void *mem = allocate_aligned(ALIGNMENT, nbuckets * sizeof(Bucket));
+            // zeroing also faults the pages in before any transaction touches them
+            std::memset(mem, 0, nbuckets * sizeof(Bucket));
+
+            Table *t = new Table;
+            t->mask = nbuckets - 1;
+            t->buckets = static_cast<Bucket *>(mem);
+            t->tombstones = false;
+            t->rehashed = false;
+            return t;
+        }
+
+        static void release(Table *t) {
+            if (!t) return;
+            std::free(t->buckets);
+            delete t;
+        }
+
+        static int counter_index() {
+            static std::atomic<unsigned> next_id(0);
+            static thread_local int id = next_id.fetch_add(1) % COUNTERS;
+            return id;
+        }
+
+        void add_to_size(long n) {
+            std::atomic<long> &c = counters[counter_index()].value;
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        // locate: finds key in t. Probing stops at the
+        // first bucket with a never used slot.
+        bool locate(Table *t, const K &key, uint64_t h, Bucket *&bucket, int &slot) const {
+            for (std::size_t i = 0, b = h & t->mask; i <= t->mask; i++, b = (b + 1) & t->mask) {
+                Bucket &bk = t->buckets[b];
+                for (int s = 0; s < SLOTS; s++) {
+                    if ((bk.used & (1u << s)) && equal(bk.keys[s], key)) {
+                        bucket = &bk;
+                        slot = s;
+                        return true;
+                    }
+                }
+                if ((bk.used | bk.deleted) != (1u << SLOTS) - 1) return false;
+            }
+            return false;
+        }
+
+        // free_slot: first unused slot on the probe sequence of h,
+        // returns how many buckets were probed, or -1 if t is full
+        int free_slot(Table *t, uint64_t h, Bucket *&bucket, int &slot) const {
+            for (std::size_t i = 0, b = h & t->mask; i <= t->mask; i++, b = (b + 1) & t->mask) {
+                Bucket &bk = t->buckets[b];
+                uint32_t taken = bk.used;
+                if (taken != (1u << SLOTS) - 1) {
+                    bucket = &bk;
+                    slot = __builtin_ctz(~taken);
+                    return i + 1;
+                }
+            }
+            return -1;
+        }
+
+        static void put(Bucket *bucket, int slot, const K &key, const V &value) {
+            bucket->keys[slot] = key;
+            bucket->values[slot] = value;
+            bucket->used |= 1u << slot;
+            bucket->deleted &= ~(1u << slot);
+        }
+
+        static void remove(Bucket *bucket, int slot) {
+            bucket->used &= ~(1u << slot);
+            bucket->deleted |= 1u << slot;
+        }
+
+        // grow: replaces seen, which had nbuckets buckets, by a
+        // new table and starts moving the entries over. seen may
+        // be freed already and is only compared. Rehashes at the
+        // same size if the table is mostly tombstones (reclaim),
+        // but not twice in a row, or a cluster of colliding keys
+        // would copy the table on every insert into it.
+        void grow(Table *seen, std::size_t nbuckets, bool reclaim) {
+            const std::size_t seen_buckets = nbuckets;
+            if (!reclaim || size() * 4 > nbuckets * SLOTS) nbuckets *= 2;
+
+            Table *fresh = allocate(nbuckets);
+            fresh->rehashed = nbuckets == seen_buckets;
+            bool installed = false;
+            {
+                unsigned char status = 0;
+                TSXGuard guard(max_retries, lock, status);
+                // a table allocated where seen was would still have to
+                // be the same size for the resize to make sense
+                Table *now = current.load(std::memory_order_relaxed);
+                if (now == seen && now->mask + 1 == seen_buckets &&
+                    old.load(std::memory_order_relaxed) == nullptr) {
+                    old.store(seen, std::memory_order_relaxed);
+                    current.store(fresh, std::memory_order_relaxed);
+                    migration.next = 0;
+                    installed = true;
+                }
+            }
+            if (!installed) release(fresh);
+        }
+
+        // help_migrate: moves the next MIGRATE_BATCH buckets
+        // of the old table, if there is one, to the current table
+        void help_migrate() {
+            if (old.load(std::memory_order_relaxed) == nullptr) return;
+
+            Table *detached = nullptr;
+            {
+                unsigned char status = 0;
+                TSXGuard guard(max_retries, lock, status);
+                Table *from = old.load(std::memory_order_relaxed);
+                if (from) {
+                    Table *to = current.load(std::memory_order_relaxed);
+                    std::size_t begin = migration.next;
+                    std::size_t end = begin + MIGRATE_BATCH;
+                    if (end > from->mask + 1) end = from->mask + 1;
+
+                    for (std::size_t b = begin; b < end; b++) {
+                        Bucket &bk = from->buckets[b];
+                        for (int s = 0; s < SLOTS; s++) {
+                            if (!(bk.used & (1u << s))) continue;
+                            Bucket *dst = nullptr;
+                            int slot = 0;
+                            // the new table is never full while migrating
+                            free_slot(to, hash(bk.keys[s]), dst, slot);
+                            put(dst, slot, bk.keys[s], bk.values[s]);
+                            remove(&bk, s);
+                        }
+                    }
+
+                    migration.next = end;
+                    if (end == from->mask + 1) {
+                        old.store(nullptr, std::memory_order_relaxed);
+                        detached = from;
+                    }
+                }
+            }
+            // any transaction still reading the old table
+            // was aborted when it was detached
+            release(detached);
+        }
+
+        bool insert_impl(const K &key, const V &value, bool assign) {
+            const uint64_t h = hash(key);
+            enum { INSERTED, EXISTS, FULL } result;
+
+            for (;;) {
+                Table *seen;
+                std::size_t seen_buckets = 0;
+                bool reclaim = false;
+                {
+                    unsigned char status = 0;
+                    TSXGuard guard(max_retries, lock, status);
+                    Table *from = old.load(std::memory_order_relaxed);
+                    seen = current.load(std::memory_order_relaxed);
+
+                    Bucket *bucket = nullptr;
+                    int slot = 0;
+                    if ((from && locate(from, key, h, bucket, slot)) || locate(seen, key, h, bucket, slot)) {
+                        if (assign) bucket->values[slot] = value;
+                        result = EXISTS;
+                    } else {
+                        int probed = free_slot(seen, h, bucket, slot);
+                        // too long a probe sequence, resize unless one is in progress
+                        if (probed < 0 || (probed > MAX_PROBE && !from)) {
+                            // read here, seen may be freed once the guard is released
+                            seen_buckets = seen->mask + 1;
+                            reclaim = seen->tombstones && !seen->rehashed;
+                            result = FULL;
+                        } else {
+                            put(bucket, slot, key, value);
+                            add_to_size(1);
+                            result = INSERTED;
+                        }
+                    }
+                }
+
+                if (result != FULL) break;
+
+                if (old.load(std::memory_order_relaxed)) help_migrate();
+                else grow(seen, seen_buckets, reclaim);
+            }
+
+            help_migrate();
+            return result == INSERTED;
+        }
+
+    public:
+        // initial_capacity: entries the map holds before its first resize
+        explicit HashMap(std::size_t initial_capacity = 1024,
+                         int max_tx_retries = machine_profile().max_retries):
+        current(nullptr),
+        old(nullptr),
+        max_retries(max_tx_retries)
+        {
+            std::size_t nbuckets = 1;
+            while (nbuckets * SLOTS < 2 * initial_capacity) nbuckets *= 2;
+            current.store(allocate(nbuckets));
+            migration.next = 0;
+            for (int i = 0; i < COUNTERS; i++) counters[i].value.store(0);
+        }
+
+        ~HashMap() {
+            release(old.load());
+            release(current.load());
+        }
+
+        // find: copies the value of key into value,
+        // returns false if key is not in the map
+        bool find(const K &key, V &value) {
+            const uint64_t h = hash(key);
+            bool found = false;
+            {
+                unsigned char status = 0;
+                TSXGuard guard(max_retries, lock, status);
+                Table *from = old.load(std::memory_order_relaxed);
+                Bucket *bucket = nullptr;
+                int slot = 0;
+                if ((from && locate(from, key, h, bucket, slot)) ||
+                    locate(current.load(std::memory_order_relaxed), key, h, bucket, slot)) {
+                    value = bucket->values[slot];
+                    found = true;
+                }
+            }
+            return found;
+        }
+
+        bool contains(const K &key) {
+            V value;
+            return find(key, value);
+        }
+
+        // insert: adds key if it is not in the map yet,
+        // returns false (leaving the map unchanged) otherwise
+        bool insert(const K &key, const V &value) {
+            return insert_impl(key, value, false);
+        }
+
+        // insert_or_assign: adds key or overwrites its value,
+        // returns true if key was added
+        bool insert_or_assign(const K &key, const V &value) {
+            return insert_impl(key, value, true);
+        }
+
+        // erase: removes key, returns false if it was not in the map
+        bool erase(const K &key) {
+            const uint64_t h = hash(key);
+            bool erased = false;
+            {
+                unsigned char status = 0;
+                TSXGuard guard(max_retries, lock, status);
+                Table *from = old.load(std::memory_order_relaxed);
+                Table *to = current.load(std::memory_order_relaxed);
+                Table *in = nullptr;
+                Bucket *bucket = nullptr;
+                int slot = 0;
+                if (from && locate(from, key, h, bucket, slot)) in = from;
+                else if (locate(to, key, h, bucket, slot)) in = to;
+                if (in) {
+                    remove(bucket, slot);
+                    // written once per table, it is read by every operation
+                    if (!in->tombstones) in->tombstones = true;
+                    add_to_size(-1);
+                    erased = true;
+                }
+            }
+            help_migrate();
+            return erased;
+        }
+
+        // size: number of entries, exact only when
+        // no operation is running concurrently
+        std::size_t size() const {
+            long total = 0;
+            for (int i = 0; i < COUNTERS; i++) total += counters[i].value.load(std::memory_order_relaxed);
+            return total < 0 ? 0 : total;
+        }
+
+        // capacity: entries the current table can hold
+        std::size_t capacity() const {
+            return (current.load()->mask + 1) * SLOTS;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef INCLUDE_TSX_HUGE_REGION_HPP
+
+    #define INCLUDE_TSX_HUGE_REGION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+#include "TSXGuard.hpp"
+
+namespace TSX {
+
+    // HugeRegion: a fixed block of memory for transactional working
+    // sets, mapped up front so that transactions on it neither fault
+    // (a fault aborts them) nor miss the TLB as often.
+    //
+    // The region comes from hugetlbfs (MAP_HUGETLB) when huge pages are
+    // reserved, otherwise it is a huge page aligned anonymous mapping
+    // advised with MADV_HUGEPAGE for transparent huge pages. Either way
+    // it is populated writable before the constructor returns.
+    //
+    // Allocations are bumped off the region, ALIGNMENT aligned so that
+    // no two share a line, and are only given back when the region is
+    // destroyed. The bump counter is shared, allocate outside
+    // transactions like the containers do.
+    class HugeRegion: public AlignedNew<ALIGNMENT> {
+    public:
+        static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    private:
+        char *base;
+        std::size_t bytes;
+        bool hugetlb;
+        alignas(ALIGNMENT) std::atomic<std::size_t> top;
+
+        static std::size_t round_up(std::size_t n, std::size_t to) {
+            return (n + to - 1) / to * to;
+        }
+
+    public:
+        explicit HugeRegion(std::size_t capacity):
+        base(nullptr),
+        bytes(round_up(capacity ? capacity : 1, HUGE_PAGE_SIZE)),
+        hugetlb(false),
+        top(0)
+        {
+            void *mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+            mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+            hugetlb = mem != MAP_FAILED;
+#endif
+            if (!hugetlb) {
+                // one huge page more, to cut an aligned region out of it
+                const std::size_t span = bytes + HUGE_PAGE_SIZE;
+                mem = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED) throw std::bad_alloc();
+
+                char *raw = static_cast<char *>(mem);
+                char *aligned = reinterpret_cast<char *>(
+                    round_up(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+                if (aligned > raw) munmap(raw, aligned - raw);
+                if (raw + span > aligned + bytes) munmap(aligned + bytes, raw + span - (aligned + bytes));
+                mem = aligned;
+#ifdef MADV_HUGEPAGE
+                madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+                // after the advice, so the faults can be served with huge pages
+                prefault(mem, bytes);
+            }
+            base = static_cast<char *>(mem);
+        }
+
+        ~HugeRegion() {
+            munmap(base, bytes);
+        }
+
+        HugeRegion(const HugeRegion &) = delete;
+        HugeRegion &operator=(const HugeRegion &) = delete;
+
+        // allocate: ALIGNMENT aligned memory for n bytes,
+        // throws std::bad_alloc once the region is used up
+        void *allocate(std::size_t n) {
+            n = round_up(n ? n : 1, ALIGNMENT);
+            std::size_t offset = top.fetch_add(n, std::memory_order_relaxed);
+            if (offset + n > bytes) throw std::bad_alloc();
+            return base + offset;
+        }
+
+        std::size_t capacity() const {
+            return bytes;
+        }
+
+        std::size_t used() const {
+            std::size_t n = top.load(std::memory_order_relaxed);
+            return n < bytes ? n : bytes;
+        }
+
+        // hugetlb_backed: whether the region is on reserved huge pages,
+        // rather than on transparent ones (if the kernel grants them)
+        bool hugetlb_backed() const {
+            return hugetlb;
+        }
+    };
+
+    // RegionAllocator: standard allocator handing out memory from
+    // a HugeRegion, deallocate is a no-op
+    template <class T>
+    class RegionAllocator {
+        template <class U> friend class RegionAllocator;
+
+        HugeRegion *region;
+
+    public:
+        typedef T value_type;
+
+        explicit RegionAllocator(HugeRegion &r) noexcept: region(&r) {}
+
+        template <class U>
+        RegionAllocator(const RegionAllocator<U> &other) noexcept: region(other.region) {}
+
+        T *allocate(std::size_t n) {
+            return static_cast<T *>(region->allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *, std::size_t) noexcept {}
+
+        template <class U>
+        bool operator==(const RegionAllocator<U> &other) const { return region == other.region; }
+
+        template <class U>
+        bool operator!=(const RegionAllocator<U> &other) const { return region != other.region; }
+    };
+
+};
+
+#endif
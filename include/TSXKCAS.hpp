@@ -0,0 +1,213 @@
+#ifndef INCLUDE_TSX_KCAS_HPP
+
+    #define INCLUDE_TSX_KCAS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "TSXEpoch.hpp"
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // k-word compare-and-swap.
+    //
+    // kcas(k, addrs, expected, desired) atomically replaces the values
+    // of k words by desired if all of them hold expected. The fast path
+    // is one RTM transaction reading and writing the words. If it keeps
+    // aborting, kcas falls back to the lock-free software k-CAS of
+    // Harris, Fraser and Pratt ("A Practical Multi-Word Compare-and-Swap
+    // Operation"), which installs a descriptor in every word with
+    // RDCSS and lets other threads help it finish, so no lock is taken.
+    //
+    // Words are KCASWord and hold values with the two low bits clear
+    // (aligned pointers, or integers shifted left by two), the low bits
+    // tag descriptors. A word that kcas may be working on must be read
+    // with kcas_read, which helps pending operations, and only written
+    // with kcas.
+    //
+    // Descriptors are freed through Epoch: a thread pins the epoch
+    // while it may dereference descriptors.
+    typedef std::atomic<uintptr_t> KCASWord;
+
+    static constexpr int KCAS_MAX_WORDS = 16;
+    static constexpr int ABORT_KCAS_DESCRIPTOR = 0xed;
+
+    namespace kcas_internal {
+
+        static constexpr uintptr_t RDCSS_TAG = 1;
+        static constexpr uintptr_t CASN_TAG = 2;
+        static constexpr uintptr_t TAG_MASK = 3;
+
+        enum : uintptr_t { UNDECIDED = 0, SUCCEEDED = 4, FAILED = 8 };
+
+        struct Entry {
+            KCASWord *addr;
+            uintptr_t expected;
+            uintptr_t desired;
+        };
+
+        struct CASNDescriptor {
+            std::atomic<uintptr_t> status;
+            int n;
+            Entry entries[KCAS_MAX_WORDS];
+        };
+
+        // RDCSSDescriptor: install casn in word if it holds
+        // expected, but only while casn is undecided
+        struct RDCSSDescriptor {
+            CASNDescriptor *casn;
+            KCASWord *word;
+            uintptr_t expected;
+        };
+
+        inline bool is_rdcss(uintptr_t v) { return (v & TAG_MASK) == RDCSS_TAG; }
+        inline bool is_casn(uintptr_t v) { return (v & TAG_MASK) == CASN_TAG; }
+
+        inline RDCSSDescriptor *as_rdcss(uintptr_t v) { return reinterpret_cast<RDCSSDescriptor *>(v & ~TAG_MASK); }
+        inline CASNDescriptor *as_casn(uintptr_t v) { return reinterpret_cast<CASNDescriptor *>(v & ~TAG_MASK); }
+
+        inline uintptr_t tagged(RDCSSDescriptor *d) { return reinterpret_cast<uintptr_t>(d) | RDCSS_TAG; }
+        inline uintptr_t tagged(CASNDescriptor *d) { return reinterpret_cast<uintptr_t>(d) | CASN_TAG; }
+
+        inline void complete(RDCSSDescriptor *d) {
+            uintptr_t self = tagged(d);
+            uintptr_t next = d->casn->status.load() == UNDECIDED ? tagged(d->casn) : d->expected;
+            d->word->compare_exchange_strong(self, next);
+        }
+
+        // rdcss: returns the value the word held, d was installed
+        // (and completed) if that is d->expected
+        inline uintptr_t rdcss(RDCSSDescriptor *d) {
+            uintptr_t r;
+            for (;;) {
+                r = d->expected;
+                if (d->word->compare_exchange_strong(r, tagged(d))) break;
+                if (!is_rdcss(r)) break;
+                complete(as_rdcss(r));
+            }
+            if (r == d->expected) complete(d);
+            return r;
+        }
+
+        inline uintptr_t rdcss_read(KCASWord *word) {
+            for (;;) {
+                uintptr_t r = word->load();
+                if (!is_rdcss(r)) return r;
+                complete(as_rdcss(r));
+            }
+        }
+
+        inline bool casn(CASNDescriptor *cd) {
+            if (cd->status.load() == UNDECIDED) {
+                uintptr_t status = SUCCEEDED;
+                for (int i = 0; i < cd->n && status == SUCCEEDED; ) {
+                    RDCSSDescriptor *d = new RDCSSDescriptor{ cd, cd->entries[i].addr, cd->entries[i].expected };
+                    uintptr_t v = rdcss(d);
+                    Epoch::retire(d);
+                    if (is_casn(v)) {
+                        if (as_casn(v) != cd) {
+                            casn(as_casn(v));   // help, then retry this word
+                            continue;
+                        }
+                    } else if (v != cd->entries[i].expected) {
+                        status = FAILED;
+                    }
+                    i++;
+                }
+                uintptr_t undecided = UNDECIDED;
+                cd->status.compare_exchange_strong(undecided, status);
+            }
+
+            const bool succeeded = cd->status.load() == SUCCEEDED;
+            for (int i = 0; i < cd->n; i++) {
+                uintptr_t self = tagged(cd);
+                cd->entries[i].addr->compare_exchange_strong(self,
+                    succeeded ? cd->entries[i].desired : cd->entries[i].expected);
+            }
+            return succeeded;
+        }
+
+        inline bool htm_kcas(std::size_t k, KCASWord *const *addrs, const uintptr_t *expected,
+                             const uintptr_t *desired, int max_retries, bool &result) {
+            for (int attempt = 0; attempt < max_retries; attempt++) {
+                unsigned int status = _xbegin();
+                if (status == _XBEGIN_STARTED) {
+                    for (std::size_t i = 0; i < k; i++) {
+                        uintptr_t v = addrs[i]->load(std::memory_order_relaxed);
+                        if (v & TAG_MASK) _xabort(ABORT_KCAS_DESCRIPTOR);
+                        if (v != expected[i]) {
+                            _xend();
+                            result = false;
+                            return true;
+                        }
+                    }
+                    for (std::size_t i = 0; i < k; i++) addrs[i]->store(desired[i], std::memory_order_relaxed);
+                    _xend();
+                    result = true;
+                    return true;
+                }
+                // a software k-CAS is in progress, or the words do not fit
+                if ((status & _XABORT_EXPLICIT) || (status & _XABORT_CAPACITY)) return false;
+                if (!(status & (_XABORT_RETRY | _XABORT_CONFLICT))) return false;
+            }
+            return false;
+        }
+
+    };
+
+    // kcas_read: value of a word, helping any k-CAS in progress on it
+    inline uintptr_t kcas_read(KCASWord &word) {
+        Epoch::Pin pin;
+        for (;;) {
+            uintptr_t v = kcas_internal::rdcss_read(&word);
+            if (!kcas_internal::is_casn(v)) return v;
+            kcas_internal::casn(kcas_internal::as_casn(v));
+        }
+    }
+
+    // kcas_software: the lock-free software k-CAS alone,
+    // without trying a transaction first
+    inline bool kcas_software(std::size_t k, KCASWord *const *addrs, const uintptr_t *expected,
+                              const uintptr_t *desired) {
+        using namespace kcas_internal;
+        CASNDescriptor *cd = new CASNDescriptor;
+        cd->status.store(UNDECIDED, std::memory_order_relaxed);
+        cd->n = k;
+        for (std::size_t i = 0; i < k; i++) cd->entries[i] = Entry{ addrs[i], expected[i], desired[i] };
+        // a global order on the words keeps helpers from livelocking
+        std::sort(cd->entries, cd->entries + k, [](const Entry &a, const Entry &b) { return a.addr < b.addr; });
+
+        bool succeeded;
+        {
+            Epoch::Pin pin;
+            succeeded = casn(cd);
+            Epoch::retire(cd);
+        }
+        return succeeded;
+    }
+
+    // kcas: replaces the values of addrs[0..k) by desired if they all
+    // hold expected, returns false (changing nothing) otherwise.
+    // k is at most KCAS_MAX_WORDS and the words must be distinct.
+    inline bool kcas(std::size_t k, KCASWord *const *addrs, const uintptr_t *expected,
+                     const uintptr_t *desired, int max_retries = machine_profile().max_retries) {
+        bool result = false;
+        if (kcas_internal::htm_kcas(k, addrs, expected, desired, max_retries, result)) return result;
+        return kcas_software(k, addrs, expected, desired);
+    }
+
+    template <std::size_t K>
+    bool kcas(KCASWord *const (&addrs)[K], const uintptr_t (&expected)[K], const uintptr_t (&desired)[K],
+              int max_retries = machine_profile().max_retries) {
+        static_assert(K <= KCAS_MAX_WORDS, "kcas supports at most KCAS_MAX_WORDS words");
+        return kcas(K, addrs, expected, desired, max_retries);
+    }
+
+};
+
+#endif
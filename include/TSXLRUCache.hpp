@@ -0,0 +1,262 @@
+#ifndef INCLUDE_TSX_LRU_CACHE_HPP
+
+    #define INCLUDE_TSX_LRU_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <type_traits>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // LRUCache: fixed capacity cache evicting the least
+    // recently used entry.
+    //
+    // A chained hash table finds the entries, a doubly linked list
+    // keeps them in recency order. A hit looks the key up, copies the
+    // value and moves the entry to the front of the list in one
+    // TSXGuard. A put that misses reuses a free entry or evicts the
+    // last one, so all entries are allocated up front and nothing is
+    // allocated or freed in a transaction.
+    //
+    // Every promotion writes the front of the list, which makes it
+    // the hot spot where concurrent hits conflict. With promote_every
+    // set to N > 1 a thread only promotes every Nth of its hits (and
+    // never the entry already in front), the others are read only
+    // transactions. Recency becomes approximate, as in sampled LRU.
+    // The hits are counted outside the transactions, in striped
+    // counters of the cache.
+    template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K> >
+    class LRUCache {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "LRUCache keys and values are copied inside transactions and must be trivially copyable");
+
+    private:
+        static constexpr int HIT_STRIPES = 16;
+
+        struct alignas(CACHE_LINE_SIZE) Entry {
+            K key;
+            V value;
+            Entry *chain;       // next entry in the bucket
+            Entry *prev, *next; // recency list, or free list through next
+        };
+
+        struct alignas(ALIGNMENT) HitCounter {
+            std::atomic<unsigned> value;
+        };
+
+        Entry *entries;
+        Entry **buckets;
+        std::size_t bucket_mask;
+        const std::size_t max_entries;
+        const unsigned promote_every;
+        alignas(ALIGNMENT) Entry list;      // sentinel, list.next is the most recent
+        Entry *free_entries;
+        std::size_t count;
+        HitCounter hits[HIT_STRIPES];       // hits since the last promotion
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+        Hash hash;
+        KeyEqual equal;
+
+        LRUCache(const LRUCache &) = delete;
+        LRUCache &operator=(const LRUCache &) = delete;
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+        Entry **bucket(const K &key) {
+            return &buckets[mix_hash(hash(key)) & bucket_mask];
+        }
+
+        Entry *lookup(const K &key) {
+            for (Entry *e = *bucket(key); e; e = e->chain) {
+                if (equal(e->key, key)) return e;
+            }
+            return nullptr;
+        }
+
+        void unlink_chain(Entry *e) {
+            Entry **ref = bucket(e->key);
+            while (*ref != e) ref = &(*ref)->chain;
+            *ref = e->chain;
+        }
+
+        void unlink_list(Entry *e) {
+            e->prev->next = e->next;
+            e->next->prev = e->prev;
+        }
+
+        void push_front(Entry *e) {
+            e->prev = &list;
+            e->next = list.next;
+            list.next->prev = e;
+            list.next = e;
+        }
+
+        void promote(Entry *e) {
+            if (list.next == e) return;
+            unlink_list(e);
+            push_front(e);
+        }
+
+        static int stripe() {
+            static std::atomic<unsigned> next_id(0);
+            static thread_local int id = next_id.fetch_add(1) % HIT_STRIPES;
+            return id;
+        }
+
+        // promotion_due: whether the next hit of this thread is
+        // one to promote. Threads sharing a stripe share the count.
+        bool promotion_due() {
+            return promote_every == 1 || hits[stripe()].value.load(std::memory_order_relaxed) + 1 >= promote_every;
+        }
+
+        void count_hit(bool promoted) {
+            std::atomic<unsigned> &c = hits[stripe()].value;
+            c.store(promoted ? 0 : c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+    public:
+        explicit LRUCache(std::size_t capacity, unsigned promote_every_nth = 1,
+                          int max_tx_retries = machine_profile().max_retries):
+        entries(nullptr),
+        buckets(nullptr),
+        bucket_mask(0),
+        max_entries(capacity < 1 ? 1 : capacity),
+        promote_every(promote_every_nth < 1 ? 1 : promote_every_nth),
+        free_entries(nullptr),
+        count(0),
+        max_retries(max_tx_retries)
+        {
+            std::size_t nbuckets = 1;
+            while (nbuckets < max_entries) nbuckets <<= 1;
+            bucket_mask = nbuckets - 1;
+
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, max_entries * sizeof(Entry));
+            entries = static_cast<Entry *>(mem);
+            buckets = static_cast<Entry **>(std::calloc(nbuckets, sizeof(Entry *)));
+            if (!buckets) {
+                std::free(entries);
+                throw std::bad_alloc();
+            }
+
+            for (std::size_t i = 0; i < max_entries; i++) {
+                entries[i].next = free_entries;
+                free_entries = &entries[i];
+            }
+            list.prev = list.next = &list;
+            for (int i = 0; i < HIT_STRIPES; i++) hits[i].value.store(0, std::memory_order_relaxed);
+        }
+
+        ~LRUCache() {
+            std::free(buckets);
+            std::free(entries);
+        }
+
+        std::size_t capacity() const { return max_entries; }
+
+        // get: copies the value of key into value and marks it
+        // as recently used, returns false on a miss
+        bool get(const K &key, V &value, TSXStats *stats = nullptr) {
+            bool hit = false;
+            const bool due = promotion_due();
+            atomically([&]() {
+                Entry *e = lookup(key);
+                hit = e != nullptr;
+                if (hit) {
+                    value = e->value;
+                    if (due) promote(e);
+                }
+            }, stats);
+            if (hit && promote_every > 1) count_hit(due);
+            return hit;
+        }
+
+        // put: inserts or overwrites key, evicting the least
+        // recently used entry if the cache is full.
+        // Returns true if an entry was evicted.
+        bool put(const K &key, const V &value, TSXStats *stats = nullptr) {
+            bool evicted = false;
+            atomically([&]() {
+                evicted = false;
+                Entry *e = lookup(key);
+                if (e) {
+                    e->value = value;
+                    promote(e);
+                    return;
+                }
+
+                if (free_entries) {
+                    e = free_entries;
+                    free_entries = e->next;
+                    count++;
+                } else {
+                    e = list.prev;
+                    unlink_list(e);
+                    unlink_chain(e);
+                    evicted = true;
+                }
+
+                e->key = key;
+                e->value = value;
+                Entry **b = bucket(key);
+                e->chain = *b;
+                *b = e;
+                push_front(e);
+            }, stats);
+            return evicted;
+        }
+
+        // erase: removes key, returns false if it was not cached
+        bool erase(const K &key, TSXStats *stats = nullptr) {
+            bool erased = false;
+            atomically([&]() {
+                Entry *e = lookup(key);
+                erased = e != nullptr;
+                if (erased) {
+                    unlink_chain(e);
+                    unlink_list(e);
+                    e->next = free_entries;
+                    free_entries = e;
+                    count--;
+                }
+            }, stats);
+            return erased;
+        }
+
+        bool contains(const K &key, TSXStats *stats = nullptr) {
+            bool found = false;
+            atomically([&]() {
+                found = lookup(key) != nullptr;
+            }, stats);
+            return found;
+        }
+
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t n = 0;
+            atomically([&]() {
+                n = count;
+            }, stats);
+            return n;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef INCLUDE_TSX_NODE_POOL_HPP
+
+    #define INCLUDE_TSX_NODE_POOL_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "TSXGuard.hpp"
+
+namespace TSX {
+
+    // NodePool: per-thread size class allocator that can be used
+    // inside transactions.
+    //
+    // Every thread keeps a free list per size class (16 bytes to
+    // MAX_BLOCK, powers of two). Allocating and freeing only touch the
+    // thread's own cache and the block itself, never shared allocator
+    // metadata, and make no system calls. Blocks of CACHE_LINE_SIZE
+    // bytes or more start on a line of their own.
+    //
+    // Free lists are refilled from a shared depot, or from pre-faulted
+    // chunks of CHUNK_BYTES when it is empty. A list that grows past two
+    // chunks worth of blocks (or twice what was reserved) gives half of
+    // them back to the depot, so blocks freed by a consumer thread find
+    // their way back to the producer allocating them. A refill is
+    // never done in a transaction: allocating from an empty list in one
+    // aborts it with ABORT_POOL_EMPTY, which sends TSXGuard straight to
+    // its fall-back lock, where the refill runs. reserve() fills a list
+    // up front, so that the transactions after it do not run dry.
+    //
+    // Freeing in a transaction does not write the block (which other
+    // transactions may still be reading), it is recorded and linked into
+    // the free list by the next pool call outside a transaction, or by
+    // flush() after the guard is released. Freeing more than PENDING_MAX
+    // blocks in one transaction aborts it with ABORT_POOL_EMPTY too.
+    //
+    // Larger requests go to malloc and are not transaction safe.
+    class NodePool {
+    public:
+        static constexpr std::size_t MIN_BLOCK = 16;
+        static constexpr std::size_t MAX_BLOCK = 2048;
+        static constexpr int CLASSES = 8;
+        static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+        static constexpr int PENDING_MAX = 64;
+        // not a user abort code, so the guard takes the fall-back lock
+        static constexpr int ABORT_POOL_EMPTY = USER_OPTION_LOWER_BOUND;
+
+    private:
+        struct Block {
+            Block *next;
+        };
+
+        struct Depot {
+            SpinLock lock;
+            Block *free[CLASSES];
+        };
+
+        struct alignas(CACHE_LINE_SIZE) Cache {
+            Block *free[CLASSES];
+            std::size_t count[CLASSES];
+            std::size_t high_water[CLASSES];    // count above which half goes to the depot
+            void *pending[PENDING_MAX];
+            unsigned char pending_class[PENDING_MAX];
+            int npending;
+
+            Cache(): npending(0) {
+                for (int k = 0; k < CLASSES; k++) {
+                    free[k] = nullptr;
+                    count[k] = 0;
+                    high_water[k] = 2 * (CHUNK_BYTES / block_size(k));
+                }
+            }
+
+            // hands the free blocks to the depot when the thread exits
+            ~Cache() {
+                drain(*this);
+                Depot &d = depot();
+                d.lock.lock();
+                for (int k = 0; k < CLASSES; k++) {
+                    while (free[k]) {
+                        Block *b = free[k];
+                        free[k] = b->next;
+                        b->next = d.free[k];
+                        d.free[k] = b;
+                    }
+                }
+                d.lock.unlock();
+            }
+        };
+
+        static Depot &depot() {
+            static Depot d;
+            return d;
+        }
+
+        static Cache &cache() {
+            static thread_local Cache c;
+            return c;
+        }
+
+        static int size_class(std::size_t bytes) {
+            int k = 0;
+            for (std::size_t block = MIN_BLOCK; block < bytes; block <<= 1) k++;
+            return k;
+        }
+
+        static std::size_t block_size(int k) {
+            return MIN_BLOCK << k;
+        }
+
+        static void push(Cache &c, int k, void *p) {
+            Block *b = static_cast<Block *>(p);
+            b->next = c.free[k];
+            c.free[k] = b;
+            c.count[k]++;
+        }
+
+        // trim: gives half of the free list of class k
+        // to the depot once it is above its high water mark
+        static void trim(Cache &c, int k) {
+            if (c.count[k] <= c.high_water[k]) return;
+            Depot &d = depot();
+            d.lock.lock();
+            while (c.count[k] > c.high_water[k] / 2) {
+                Block *b = c.free[k];
+                c.free[k] = b->next;
+                c.count[k]--;
+                b->next = d.free[k];
+                d.free[k] = b;
+            }
+            d.lock.unlock();
+        }
+
+        static void drain(Cache &c) {
+            for (int i = 0; i < c.npending; i++) push(c, c.pending_class[i], c.pending[i]);
+            for (int i = 0; i < c.npending; i++) trim(c, c.pending_class[i]);
+            c.npending = 0;
+        }
+
+        static void refill(Cache &c, int k) {
+            const std::size_t size = block_size(k);
+            const std::size_t batch = CHUNK_BYTES / size;
+
+            Depot &d = depot();
+            std::size_t taken = 0;
+            d.lock.lock();
+            for (; taken < batch && d.free[k]; taken++) {
+                Block *b = d.free[k];
+                d.free[k] = b->next;
+                push(c, k, b);
+            }
+            d.lock.unlock();
+            if (taken) return;
+
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, CHUNK_BYTES);
+            // touch every page now rather than in a transaction later
+            std::memset(mem, 0, CHUNK_BYTES);
+            char *chunk = static_cast<char *>(mem);
+            for (std::size_t i = batch; i-- > 0; ) push(c, k, chunk + i * size);
+        }
+
+    public:
+        // allocate: a block of at least bytes bytes. In a transaction,
+        // aborts it with ABORT_POOL_EMPTY if the free list is empty.
+        static void *allocate(std::size_t bytes) {
+            if (bytes > MAX_BLOCK) {
+                void *p = std::malloc(bytes);
+                if (!p) throw std::bad_alloc();
+                return p;
+            }
+            Cache &c = cache();
+            const int k = size_class(bytes);
+            const bool in_tx = _xtest();
+            if (!in_tx && c.npending) drain(c);
+
+            if (!c.free[k]) {
+                if (in_tx) _xabort(ABORT_POOL_EMPTY);
+                refill(c, k);
+            }
+            Block *b = c.free[k];
+            c.free[k] = b->next;
+            c.count[k]--;
+            return b;
+        }
+
+        // deallocate: returns a block of bytes bytes to this
+        // thread's cache, deferred if in a transaction. Aborts the
+        // transaction with ABORT_POOL_EMPTY if PENDING_MAX are already.
+        static void deallocate(void *p, std::size_t bytes) {
+            if (!p) return;
+            if (bytes > MAX_BLOCK) {
+                std::free(p);
+                return;
+            }
+            Cache &c = cache();
+            const int k = size_class(bytes);
+            if (_xtest()) {
+                if (c.npending == PENDING_MAX) _xabort(ABORT_POOL_EMPTY);
+                c.pending[c.npending] = p;
+                c.pending_class[c.npending] = k;
+                c.npending++;
+                return;
+            }
+            if (c.npending) drain(c);
+            push(c, k, p);
+            trim(c, k);
+        }
+
+        // reserve: makes sure this thread can allocate count blocks
+        // of bytes bytes without a refill. Call it outside transactions.
+        static void reserve(std::size_t bytes, std::size_t count) {
+            if (bytes > MAX_BLOCK) return;
+            Cache &c = cache();
+            const int k = size_class(bytes);
+            drain(c);
+            if (c.high_water[k] < 2 * count) c.high_water[k] = 2 * count;
+            while (c.count[k] < count) refill(c, k);
+        }
+
+        // flush: links the blocks freed in transactions
+        // into the free lists. Call it outside transactions.
+        static void flush() {
+            drain(cache());
+        }
+
+        // available: blocks of bytes bytes this thread can
+        // allocate without a refill
+        static std::size_t available(std::size_t bytes) {
+            return bytes > MAX_BLOCK ? 0 : cache().count[size_class(bytes)];
+        }
+    };
+
+    // PoolAllocator: standard allocator on top of NodePool,
+    // for node based containers
+    template <class T>
+    class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        PoolAllocator() noexcept {}
+
+        template <class U>
+        PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+        T *allocate(std::size_t n) {
+            return static_cast<T *>(NodePool::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, std::size_t n) noexcept {
+            NodePool::deallocate(p, n * sizeof(T));
+        }
+    };
+
+    template <class T, class U>
+    bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) { return true; }
+
+    template <class T, class U>
+    bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) { return false; }
+
+};
+
+#endif
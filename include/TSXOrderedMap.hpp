@@ -0,0 +1,470 @@
+#ifndef INCLUDE_TSX_ORDERED_MAP_HPP
+
+    #define INCLUDE_TSX_ORDERED_MAP_HPP
+
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // OrderedMap: red-black tree whose point operations
+    // each run in one TSXGuard.
+    //
+    // Every node fills one cache line (for small keys and
+    // values), so a lookup reads one line per level and an
+    // update writes the few nodes it relinks: the classic
+    // bottom-up red-black insert and erase do at most three
+    // rotations and amortized O(1) recolorings, they only
+    // write the root when its color or the root itself changes.
+    // There is no shared sentinel node, which would be written
+    // by every erase.
+    //
+    // Nodes are allocated before the guard is taken and freed
+    // after it is released. Every access to the tree is
+    // transactional (or under the fall-back lock), so a reader
+    // still holding an unlinked node is aborted before the node
+    // is freed.
+    //
+    // Range queries run in chunks of RANGE_CHUNK entries, one
+    // transaction per chunk, so every chunk is consistent but the
+    // whole range is not a single snapshot.
+    //
+    // Every operation optionally takes a TSXStats to be run
+    // under TSXGuardWithStats instead.
+    template <class K, class V, class Compare = std::less<K> >
+    class OrderedMap {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "OrderedMap keys and values are copied inside transactions and must be trivially copyable");
+
+    public:
+        static constexpr int RANGE_CHUNK = 32;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Node {
+            Node *left, *right, *parent;
+            bool red;
+            K key;
+            V value;
+        };
+
+        alignas(ALIGNMENT) Node *root;
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+        Compare less;
+
+        OrderedMap(const OrderedMap &) = delete;
+        OrderedMap &operator=(const OrderedMap &) = delete;
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+        static Node *allocate_node(const K &key, const V &value) {
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, sizeof(Node));
+            Node *n = static_cast<Node *>(mem);
+            n->left = n->right = n->parent = nullptr;
+            n->red = true;
+            n->key = key;
+            n->value = value;
+            return n;
+        }
+
+        static void free_node(Node *n) {
+            std::free(n);
+        }
+
+        static void free_subtree(Node *n) {
+            if (!n) return;
+            free_subtree(n->left);
+            free_subtree(n->right);
+            free_node(n);
+        }
+
+        Node *lookup(const K &key) const {
+            Node *cur = root;
+            while (cur) {
+                if (less(key, cur->key)) cur = cur->left;
+                else if (less(cur->key, key)) cur = cur->right;
+                else return cur;
+            }
+            return nullptr;
+        }
+
+        // first node with key >= from, or > from if !inclusive
+        Node *lower_bound(const K &from, bool inclusive) const {
+            Node *cur = root, *best = nullptr;
+            while (cur) {
+                if (inclusive ? !less(cur->key, from) : less(from, cur->key)) {
+                    best = cur;
+                    cur = cur->left;
+                } else {
+                    cur = cur->right;
+                }
+            }
+            return best;
+        }
+
+        static Node *minimum(Node *n) {
+            while (n->left) n = n->left;
+            return n;
+        }
+
+        static Node *successor(Node *n) {
+            if (n->right) return minimum(n->right);
+            Node *p = n->parent;
+            while (p && n == p->right) {
+                n = p;
+                p = p->parent;
+            }
+            return p;
+        }
+
+        static bool is_red(const Node *n) {
+            return n && n->red;
+        }
+
+        // write colors only when they change,
+        // every write grows the write set
+        static void set_color(Node *n, bool red) {
+            if (n->red != red) n->red = red;
+        }
+
+        void replace_child(Node *parent, Node *old_child, Node *new_child) {
+            if (!parent) root = new_child;
+            else if (parent->left == old_child) parent->left = new_child;
+            else parent->right = new_child;
+        }
+
+        void rotate_left(Node *x) {
+            Node *y = x->right;
+            x->right = y->left;
+            if (y->left) y->left->parent = x;
+            y->parent = x->parent;
+            replace_child(x->parent, x, y);
+            y->left = x;
+            x->parent = y;
+        }
+
+        void rotate_right(Node *x) {
+            Node *y = x->left;
+            x->left = y->right;
+            if (y->right) y->right->parent = x;
+            y->parent = x->parent;
+            replace_child(x->parent, x, y);
+            y->right = x;
+            x->parent = y;
+        }
+
+        void insert_fixup(Node *z) {
+            while (is_red(z->parent)) {
+                Node *p = z->parent;
+                Node *g = p->parent;     // p is red, so it is not the root
+                if (p == g->left) {
+                    Node *u = g->right;
+                    if (is_red(u)) {
+                        set_color(p, false);
+                        set_color(u, false);
+                        set_color(g, true);
+                        z = g;
+                    } else {
+                        if (z == p->right) {
+                            rotate_left(p);
+                            z = p;
+                            p = z->parent;
+                        }
+                        set_color(p, false);
+                        set_color(g, true);
+                        rotate_right(g);
+                    }
+                } else {
+                    Node *u = g->left;
+                    if (is_red(u)) {
+                        set_color(p, false);
+                        set_color(u, false);
+                        set_color(g, true);
+                        z = g;
+                    } else {
+                        if (z == p->left) {
+                            rotate_right(p);
+                            z = p;
+                            p = z->parent;
+                        }
+                        set_color(p, false);
+                        set_color(g, true);
+                        rotate_left(g);
+                    }
+                }
+            }
+            set_color(root, false);
+        }
+
+        // x (possibly null) carries an extra black, parent is its parent
+        void erase_fixup(Node *x, Node *parent) {
+            while (x != root && !is_red(x)) {
+                if (x == parent->left) {
+                    Node *w = parent->right;
+                    if (is_red(w)) {
+                        set_color(w, false);
+                        set_color(parent, true);
+                        rotate_left(parent);
+                        w = parent->right;
+                    }
+                    if (!is_red(w->left) && !is_red(w->right)) {
+                        set_color(w, true);
+                        x = parent;
+                        parent = x->parent;
+                    } else {
+                        if (!is_red(w->right)) {
+                            set_color(w->left, false);
+                            set_color(w, true);
+                            rotate_right(w);
+                            w = parent->right;
+                        }
+                        set_color(w, parent->red);
+                        set_color(parent, false);
+                        set_color(w->right, false);
+                        rotate_left(parent);
+                        x = root;
+                        parent = nullptr;
+                    }
+                } else {
+                    Node *w = parent->left;
+                    if (is_red(w)) {
+                        set_color(w, false);
+                        set_color(parent, true);
+                        rotate_right(parent);
+                        w = parent->left;
+                    }
+                    if (!is_red(w->left) && !is_red(w->right)) {
+                        set_color(w, true);
+                        x = parent;
+                        parent = x->parent;
+                    } else {
+                        if (!is_red(w->left)) {
+                            set_color(w->right, false);
+                            set_color(w, true);
+                            rotate_left(w);
+                            w = parent->left;
+                        }
+                        set_color(w, parent->red);
+                        set_color(parent, false);
+                        set_color(w->left, false);
+                        rotate_right(parent);
+                        x = root;
+                        parent = nullptr;
+                    }
+                }
+            }
+            if (x) set_color(x, false);
+        }
+
+        // unlink z from the tree, z is not freed
+        void unlink(Node *z) {
+            Node *y = z;
+            bool removed_red = y->red;
+            Node *x, *x_parent;
+
+            if (!z->left) {
+                x = z->right;
+                x_parent = z->parent;
+                replace_child(z->parent, z, x);
+                if (x) x->parent = x_parent;
+            } else if (!z->right) {
+                x = z->left;
+                x_parent = z->parent;
+                replace_child(z->parent, z, x);
+                if (x) x->parent = x_parent;
+            } else {
+                // relink the successor in place of z
+                y = minimum(z->right);
+                removed_red = y->red;
+                x = y->right;
+                if (y->parent == z) {
+                    x_parent = y;
+                } else {
+                    x_parent = y->parent;
+                    replace_child(y->parent, y, x);
+                    if (x) x->parent = x_parent;
+                    y->right = z->right;
+                    y->right->parent = y;
+                }
+                replace_child(z->parent, z, y);
+                y->parent = z->parent;
+                y->left = z->left;
+                y->left->parent = y;
+                set_color(y, z->red);
+            }
+
+            if (!removed_red) erase_fixup(x, x_parent);
+        }
+
+        bool insert_impl(const K &key, const V &value, bool assign, TSXStats *stats) {
+            Node *fresh = allocate_node(key, value);
+            bool inserted = false;
+
+            atomically([&]() {
+                Node *parent = nullptr, *cur = root;
+                bool left = false;
+                while (cur) {
+                    parent = cur;
+                    if (less(key, cur->key)) {
+                        cur = cur->left;
+                        left = true;
+                    } else if (less(cur->key, key)) {
+                        cur = cur->right;
+                        left = false;
+                    } else {
+                        if (assign) cur->value = value;
+                        return;
+                    }
+                }
+
+                fresh->parent = parent;
+                if (!parent) root = fresh;
+                else if (left) parent->left = fresh;
+                else parent->right = fresh;
+                insert_fixup(fresh);
+                inserted = true;
+            }, stats);
+
+            if (!inserted) free_node(fresh);
+            return inserted;
+        }
+
+        // returns the black height, -1 if a rule is broken
+        int verify_subtree(const Node *n, const Node *parent) const {
+            if (!n) return 1;
+            if (n->parent != parent) return -1;
+            if (n->red && (is_red(n->left) || is_red(n->right))) return -1;
+            if (n->left && !less(n->left->key, n->key)) return -1;
+            if (n->right && !less(n->key, n->right->key)) return -1;
+            int lh = verify_subtree(n->left, n);
+            int rh = verify_subtree(n->right, n);
+            if (lh < 0 || lh != rh) return -1;
+            return lh + (n->red ? 0 : 1);
+        }
+
+    public:
+        explicit OrderedMap(int max_tx_retries = machine_profile().max_retries):
+        root(nullptr),
+        max_retries(max_tx_retries)
+        {}
+
+        ~OrderedMap() {
+            free_subtree(root);
+        }
+
+        // find: copies the value of key into value,
+        // returns false if key is not in the map
+        bool find(const K &key, V &value, TSXStats *stats = nullptr) {
+            bool found = false;
+            atomically([&]() {
+                Node *n = lookup(key);
+                if (n) {
+                    value = n->value;
+                    found = true;
+                }
+            }, stats);
+            return found;
+        }
+
+        bool contains(const K &key, TSXStats *stats = nullptr) {
+            V value;
+            return find(key, value, stats);
+        }
+
+        // insert: adds key if it is not in the map yet,
+        // returns false (leaving the map unchanged) otherwise
+        bool insert(const K &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key, value, false, stats);
+        }
+
+        // insert_or_assign: adds key or overwrites its value,
+        // returns true if key was added
+        bool insert_or_assign(const K &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key, value, true, stats);
+        }
+
+        // erase: removes key, returns false if it was not in the map
+        bool erase(const K &key, TSXStats *stats = nullptr) {
+            Node *removed = nullptr;
+            atomically([&]() {
+                removed = lookup(key);
+                if (removed) unlink(removed);
+            }, stats);
+
+            if (!removed) return false;
+            free_node(removed);
+            return true;
+        }
+
+        // range: calls fn(key, value) for every key in [lo, hi],
+        // in order. fn runs outside of any transaction.
+        // Returns the number of entries visited.
+        template <class F>
+        std::size_t range(const K &lo, const K &hi, F fn, TSXStats *stats = nullptr) {
+            std::pair<K, V> chunk[RANGE_CHUNK];
+            std::size_t visited = 0;
+            K from = lo;
+            bool inclusive = true;
+
+            for (;;) {
+                int n = 0;
+                bool more = false;
+                atomically([&]() {
+                    n = 0;
+                    Node *cur = lower_bound(from, inclusive);
+                    while (cur && !less(hi, cur->key) && n < RANGE_CHUNK) {
+                        chunk[n].first = cur->key;
+                        chunk[n].second = cur->value;
+                        n++;
+                        cur = successor(cur);
+                    }
+                    more = cur && !less(hi, cur->key);
+                }, stats);
+
+                for (int i = 0; i < n; i++) fn(chunk[i].first, chunk[i].second);
+                visited += n;
+
+                if (!more) return visited;
+                from = chunk[n - 1].first;
+                inclusive = false;
+            }
+        }
+
+        // size: number of entries. Walks the whole tree
+        // in one critical section, which will usually exceed
+        // the transactional capacity and take the fall-back lock.
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t count = 0;
+            atomically([&]() {
+                count = 0;
+                for (Node *n = root ? minimum(root) : nullptr; n; n = successor(n)) count++;
+            }, stats);
+            return count;
+        }
+
+        // verify: checks the binary search tree and red-black
+        // rules, for tests. Must not run concurrently with updates.
+        bool verify() const {
+            return !is_red(root) && verify_subtree(root, nullptr) > 0;
+        }
+    };
+
+};
+
+#endif
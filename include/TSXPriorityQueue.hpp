@@ -0,0 +1,223 @@
+#ifndef INCLUDE_TSX_PRIORITY_QUEUE_HPP
+
+    #define INCLUDE_TSX_PRIORITY_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // PriorityQueue: relaxed concurrent priority queue built from
+    // several binary heaps (a MultiQueue, Rihani et al., "MultiQueues:
+    // Simple Relaxed Concurrent Priority Queues").
+    //
+    // A push adds its entry to a random heap and sifts it up, a pop
+    // looks at the tops of two random heaps and removes the smaller
+    // one, each in one TSXGuard touching a single heap: the path of
+    // the sift, logarithmic in the size of that heap. Operations on
+    // different heaps do not conflict.
+    //
+    // The order is relaxed: pop returns one of the smallest entries,
+    // how far from the true minimum depends on the number of heaps,
+    // not on the number of entries. With one heap the order is exact.
+    // pop returns false only after every heap was found empty.
+    //
+    // A full heap grows by doubling. The new array is allocated
+    // before a guard is taken and the old one freed after.
+    template <class K, class V, class Compare = std::less<K> >
+    class PriorityQueue {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "PriorityQueue keys and values are copied inside transactions and must be trivially copyable");
+
+    private:
+        struct Entry {
+            K key;
+            V value;
+        };
+
+        struct alignas(ALIGNMENT) Heap {
+            Entry *data;
+            std::size_t size;
+            std::size_t capacity;
+        };
+
+        Heap *heaps;
+        const int nheaps;
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+        Compare less;
+
+        PriorityQueue(const PriorityQueue &) = delete;
+        PriorityQueue &operator=(const PriorityQueue &) = delete;
+
+        static Entry *allocate_entries(std::size_t capacity) {
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, capacity * sizeof(Entry));
+            return static_cast<Entry *>(mem);
+        }
+
+        static unsigned random_heap(int n) {
+            static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state % n;
+        }
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+        void sift_up(Heap &h, std::size_t i) {
+            Entry e = h.data[i];
+            while (i > 0) {
+                std::size_t parent = (i - 1) / 2;
+                if (!less(e.key, h.data[parent].key)) break;
+                h.data[i] = h.data[parent];
+                i = parent;
+            }
+            h.data[i] = e;
+        }
+
+        void sift_down(Heap &h, std::size_t i) {
+            Entry e = h.data[i];
+            for (;;) {
+                std::size_t child = 2 * i + 1;
+                if (child >= h.size) break;
+                if (child + 1 < h.size && less(h.data[child + 1].key, h.data[child].key)) child++;
+                if (!less(h.data[child].key, e.key)) break;
+                h.data[i] = h.data[child];
+                i = child;
+            }
+            h.data[i] = e;
+        }
+
+        void pop_top(Heap &h, K &key, V &value) {
+            key = h.data[0].key;
+            value = h.data[0].value;
+            h.data[0] = h.data[--h.size];
+            if (h.size > 0) sift_down(h, 0);
+        }
+
+    public:
+        // PriorityQueue: two heaps per hardware thread by default
+        explicit PriorityQueue(int heap_count = 2 * std::thread::hardware_concurrency(),
+                               std::size_t initial_capacity = 64,
+                               int max_tx_retries = machine_profile().max_retries):
+        heaps(nullptr),
+        nheaps(heap_count < 1 ? 1 : heap_count),
+        max_retries(max_tx_retries)
+        {
+            if (initial_capacity < 1) initial_capacity = 1;
+            void *mem = allocate_aligned(ALIGNMENT, nheaps * sizeof(Heap));
+            heaps = static_cast<Heap *>(mem);
+            for (int i = 0; i < nheaps; i++) {
+                heaps[i].data = allocate_entries(initial_capacity);
+                heaps[i].size = 0;
+                heaps[i].capacity = initial_capacity;
+            }
+        }
+
+        ~PriorityQueue() {
+            for (int i = 0; i < nheaps; i++) std::free(heaps[i].data);
+            std::free(heaps);
+        }
+
+        int heap_count() const { return nheaps; }
+
+        // push: adds key with value to a random heap
+        void push(const K &key, const V &value, TSXStats *stats = nullptr) {
+            Heap &h = heaps[random_heap(nheaps)];
+            Entry *spare = nullptr, *old = nullptr;
+            std::size_t spare_capacity = 0;
+
+            for (;;) {
+                bool done = false;
+                std::size_t needed = 0;
+                atomically([&]() {
+                    old = nullptr;
+                    if (h.size == h.capacity) {
+                        if (spare_capacity <= h.capacity) {
+                            needed = 2 * h.capacity;
+                            return;
+                        }
+                        for (std::size_t i = 0; i < h.size; i++) spare[i] = h.data[i];
+                        old = h.data;
+                        h.data = spare;
+                        h.capacity = spare_capacity;
+                    }
+                    h.data[h.size].key = key;
+                    h.data[h.size].value = value;
+                    sift_up(h, h.size++);
+                    done = true;
+                }, stats);
+
+                if (done) break;
+                std::free(spare);
+                spare = allocate_entries(needed);
+                spare_capacity = needed;
+            }
+
+            // the spare was either installed (old is set) or not needed
+            std::free(old ? old : spare);
+        }
+
+        // pop: removes one of the smallest entries, see above.
+        // Returns false if every heap was empty.
+        bool pop(K &key, V &value, TSXStats *stats = nullptr) {
+            bool found = false;
+            Heap &a = heaps[random_heap(nheaps)];
+            Heap &b = heaps[random_heap(nheaps)];
+            atomically([&]() {
+                Heap *h = &a;
+                if (a.size == 0 || (b.size > 0 && less(b.data[0].key, a.data[0].key))) h = &b;
+                found = h->size > 0;
+                if (found) pop_top(*h, key, value);
+            }, stats);
+            if (found) return true;
+
+            // both were empty, look at every heap before giving up
+            const int start = random_heap(nheaps);
+            for (int i = 0; i < nheaps && !found; i++) {
+                Heap &h = heaps[(start + i) % nheaps];
+                atomically([&]() {
+                    found = h.size > 0;
+                    if (found) pop_top(h, key, value);
+                }, stats);
+            }
+            return found;
+        }
+
+        // size: number of entries at some point during the call
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t count = 0;
+            atomically([&]() {
+                count = 0;
+                for (int i = 0; i < nheaps; i++) count += heaps[i].size;
+            }, stats);
+            return count;
+        }
+
+        bool empty(TSXStats *stats = nullptr) {
+            return size(stats) == 0;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef INCLUDE_TSX_PROFILE_HPP
+
+    #define INCLUDE_TSX_PROFILE_HPP
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace TSX {
+
+    // MachineProfile holds the transactional limits
+    // of the host, as measured by benchmarks/capacity_probe.
+    // The defaults are conservative values for a
+    // Skylake-class core with a 32KB L1 data cache.
+    struct MachineProfile {
+        bool rtm_usable;        // false if transactions never commit on this host
+        int read_capacity;      // cache lines that can be read in one transaction
+        int write_capacity;     // cache lines that can be written in one transaction
+        long max_cycles;        // longest transaction (in TSC cycles) that commits reliably
+        int max_retries;        // recommended retries before taking the fall-back lock
+
+        MachineProfile():
+        rtm_usable(true),
+        read_capacity(1024),
+        write_capacity(256),
+        max_cycles(100000),
+        max_retries(20)
+        {}
+
+        // load: reads a key=value profile file.
+        // Unknown keys are ignored and missing keys keep
+        // their current values. Returns false if the file
+        // could not be opened.
+        bool load(const std::string &path) {
+            std::ifstream in(path.c_str());
+            if (!in) return false;
+
+            std::string line;
+            while (std::getline(in, line)) {
+                if (line.empty() || line[0] == '#') continue;
+
+                std::size_t eq = line.find('=');
+                if (eq == std::string::npos) continue;
+
+                std::string key = line.substr(0, eq);
+                long value = std::strtol(line.c_str() + eq + 1, nullptr, 10);
+
+                if (key == "rtm_usable") rtm_usable = value != 0;
+                else if (key == "read_capacity") read_capacity = value;
+                else if (key == "write_capacity") write_capacity = value;
+                else if (key == "max_cycles") max_cycles = value;
+                else if (key == "max_retries") max_retries = value;
+            }
+
+            return true;
+        }
+
+        bool save(const std::string &path) const {
+            std::ofstream out(path.c_str());
+            if (!out) return false;
+
+            out << "# TSXGuard machine profile" << std::endl
+                << "rtm_usable=" << (rtm_usable ? 1 : 0) << std::endl
+                << "read_capacity=" << read_capacity << std::endl
+                << "write_capacity=" << write_capacity << std::endl
+                << "max_cycles=" << max_cycles << std::endl
+                << "max_retries=" << max_retries << std::endl;
+
+            return static_cast<bool>(out);
+        }
+    };
+
+    // machine_profile: the process wide profile.
+    // Loaded once, on first use, from the file named by
+    // the TSX_PROFILE environment variable. Falls back
+    // to the defaults if the variable is unset or the
+    // file is unreadable.
+    inline const MachineProfile &machine_profile() {
+        static const MachineProfile profile = []() {
+            MachineProfile p;
+            const char *path = std::getenv("TSX_PROFILE");
+            if (path) p.load(path);
+            return p;
+        }();
+
+        return profile;
+    }
+
+};
+
+#endif
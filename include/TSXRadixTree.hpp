@@ -0,0 +1,618 @@
+#ifndef INCLUDE_TSX_RADIX_TREE_HPP
+
+    #define INCLUDE_TSX_RADIX_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // RadixTree: adaptive radix tree (Leis et al., "The Adaptive
+    // Radix Tree: ARTful Indexing for Main-Memory Databases")
+    // mapping byte strings to values.
+    //
+    // Inner nodes are Node4, Node16, Node48 or Node256 depending
+    // on their number of children. Common prefixes are compressed
+    // into the nodes, up to MAX_PREFIX bytes are stored and longer
+    // prefixes are skipped by lookups and checked against the leaf.
+    //
+    // Every operation is one TSXGuard. Lookups only read, so they
+    // never conflict with each other. Inserts and erases grow,
+    // shrink and split nodes inside their transaction. The nodes
+    // they need are allocated beforehand: when a transaction finds
+    // it needs a node it does not have, it returns without writing,
+    // the node is allocated and the operation is retried.
+    // Replaced nodes are freed after the guard is released.
+    //
+    // Keys are terminated by an implicit zero byte, so that no key
+    // is a prefix of another. They must not contain zero bytes.
+    template <class V>
+    class RadixTree {
+        static_assert(std::is_trivially_copyable<V>::value,
+        "RadixTree values are copied inside transactions and must be trivially copyable");
+
+    public:
+        static constexpr int MAX_PREFIX = 8;
+
+    private:
+        enum Type : uint8_t { LEAF, NODE4, NODE16, NODE48, NODE256, TYPES };
+
+        struct Node {
+            uint8_t type;
+            uint16_t count;             // children
+            uint32_t prefix_len;
+            uint8_t prefix[MAX_PREFIX]; // first bytes of the prefix
+        };
+
+        struct Leaf : Node {
+            V value;
+            uint32_t len;
+            char key[1];                // len bytes, allocated past the end
+        };
+
+        struct Node4 : Node {
+            uint8_t keys[4];
+            Node *children[4];
+        };
+
+        struct Node16 : Node {
+            alignas(16) uint8_t keys[16];
+            Node *children[16];
+        };
+
+        struct Node48 : Node {
+            uint8_t index[256];         // slot + 1, 0 if empty
+            Node *children[48];
+        };
+
+        struct Node256 : Node {
+            Node *children[256];
+        };
+
+        enum Outcome { DONE, ABSENT, EXISTS, NEED };
+
+        alignas(ALIGNMENT) Node *root;
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+
+        RadixTree(const RadixTree &) = delete;
+        RadixTree &operator=(const RadixTree &) = delete;
+
+        static void *allocate(std::size_t bytes) {
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, bytes);
+            std::memset(mem, 0, bytes);
+            return mem;
+        }
+
+        static Node *allocate_node(int type) {
+            static const std::size_t bytes[TYPES] = {
+                0, sizeof(Node4), sizeof(Node16), sizeof(Node48), sizeof(Node256)
+            };
+            Node *n = static_cast<Node *>(allocate(bytes[type]));
+            n->type = type;
+            return n;
+        }
+
+        static Leaf *allocate_leaf(const char *key, std::size_t len, const V &value) {
+            Leaf *l = static_cast<Leaf *>(allocate(sizeof(Leaf) + len));
+            l->type = LEAF;
+            l->value = value;
+            l->len = len;
+            std::memcpy(l->key, key, len);
+            return l;
+        }
+
+        static void free_subtree(Node *n) {
+            if (!n) return;
+            if (n->type != LEAF) for_each_child(n, [](uint8_t, Node *child) { free_subtree(child); });
+            std::free(n);
+        }
+
+        static uint8_t byte(const char *key, std::size_t len, std::size_t depth) {
+            return depth < len ? static_cast<uint8_t>(key[depth]) : 0;
+        }
+
+        static bool leaf_matches(const Leaf *l, const char *key, std::size_t len) {
+            return l->len == len && std::memcmp(l->key, key, len) == 0;
+        }
+
+        static bool full(const Node *n) {
+            static const int capacity[TYPES] = { 0, 4, 16, 48, 256 };
+            return n->count == capacity[n->type];
+        }
+
+        static Node **find_child(Node *n, uint8_t b) {
+            switch (n->type) {
+            case NODE4: {
+                Node4 *m = static_cast<Node4 *>(n);
+                for (int i = 0; i < m->count; i++) {
+                    if (m->keys[i] == b) return &m->children[i];
+                }
+                return nullptr;
+            }
+            case NODE16: {
+                Node16 *m = static_cast<Node16 *>(n);
+#ifdef __SSE2__
+                __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+                    _mm_load_si128(reinterpret_cast<const __m128i *>(m->keys)));
+                unsigned mask = _mm_movemask_epi8(cmp) & ((1u << m->count) - 1);
+                return mask ? &m->children[__builtin_ctz(mask)] : nullptr;
+#else
+                for (int i = 0; i < m->count; i++) {
+                    if (m->keys[i] == b) return &m->children[i];
+                }
+                return nullptr;
+#endif
+            }
+            case NODE48: {
+                Node48 *m = static_cast<Node48 *>(n);
+                return m->index[b] ? &m->children[m->index[b] - 1] : nullptr;
+            }
+            default: {
+                Node256 *m = static_cast<Node256 *>(n);
+                return m->children[b] ? &m->children[b] : nullptr;
+            }
+            }
+        }
+
+        // for_each_child: calls fn(byte, child) in byte order
+        template <class F>
+        static void for_each_child(Node *n, F fn) {
+            switch (n->type) {
+            case NODE4: {
+                Node4 *m = static_cast<Node4 *>(n);
+                for (int i = 0; i < m->count; i++) fn(m->keys[i], m->children[i]);
+                break;
+            }
+            case NODE16: {
+                Node16 *m = static_cast<Node16 *>(n);
+                for (int i = 0; i < m->count; i++) fn(m->keys[i], m->children[i]);
+                break;
+            }
+            case NODE48: {
+                Node48 *m = static_cast<Node48 *>(n);
+                for (int b = 0; b < 256; b++) {
+                    if (m->index[b]) fn(static_cast<uint8_t>(b), m->children[m->index[b] - 1]);
+                }
+                break;
+            }
+            default: {
+                Node256 *m = static_cast<Node256 *>(n);
+                for (int b = 0; b < 256; b++) {
+                    if (m->children[b]) fn(static_cast<uint8_t>(b), m->children[b]);
+                }
+                break;
+            }
+            }
+        }
+
+        // sorted_insert: keeps the keys of Node4 and Node16 in order
+        template <class N>
+        static void sorted_insert(N *m, uint8_t b, Node *child) {
+            int pos = 0;
+            while (pos < m->count && m->keys[pos] < b) pos++;
+            std::memmove(m->keys + pos + 1, m->keys + pos, m->count - pos);
+            std::memmove(m->children + pos + 1, m->children + pos, (m->count - pos) * sizeof(Node *));
+            m->keys[pos] = b;
+            m->children[pos] = child;
+        }
+
+        template <class N>
+        static void sorted_remove(N *m, uint8_t b) {
+            int pos = 0;
+            while (m->keys[pos] != b) pos++;
+            std::memmove(m->keys + pos, m->keys + pos + 1, m->count - pos - 1);
+            std::memmove(m->children + pos, m->children + pos + 1, (m->count - pos - 1) * sizeof(Node *));
+        }
+
+        // add_child: n must not be full
+        static void add_child(Node *n, uint8_t b, Node *child) {
+            switch (n->type) {
+            case NODE4:
+                sorted_insert(static_cast<Node4 *>(n), b, child);
+                break;
+            case NODE16:
+                sorted_insert(static_cast<Node16 *>(n), b, child);
+                break;
+            case NODE48: {
+                Node48 *m = static_cast<Node48 *>(n);
+                int slot = 0;
+                while (m->children[slot]) slot++;
+                m->children[slot] = child;
+                m->index[b] = slot + 1;
+                break;
+            }
+            default:
+                static_cast<Node256 *>(n)->children[b] = child;
+                break;
+            }
+            n->count++;
+        }
+
+        static void remove_child(Node *n, uint8_t b) {
+            switch (n->type) {
+            case NODE4:
+                sorted_remove(static_cast<Node4 *>(n), b);
+                break;
+            case NODE16:
+                sorted_remove(static_cast<Node16 *>(n), b);
+                break;
+            case NODE48: {
+                Node48 *m = static_cast<Node48 *>(n);
+                m->children[m->index[b] - 1] = nullptr;
+                m->index[b] = 0;
+                break;
+            }
+            default:
+                static_cast<Node256 *>(n)->children[b] = nullptr;
+                break;
+            }
+            n->count--;
+        }
+
+        // transfer: moves the prefix and children of src
+        // into dst, a node of another size
+        static void transfer(Node *src, Node *dst) {
+            dst->prefix_len = src->prefix_len;
+            std::memcpy(dst->prefix, src->prefix, MAX_PREFIX);
+            for_each_child(src, [dst](uint8_t b, Node *child) { add_child(dst, b, child); });
+        }
+
+        static Leaf *minimum(Node *n) {
+            while (n->type != LEAF) {
+                Node *first = nullptr;
+                for_each_child(n, [&first](uint8_t, Node *child) { if (!first) first = child; });
+                n = first;
+            }
+            return static_cast<Leaf *>(n);
+        }
+
+        static std::size_t stored(std::size_t prefix_len) {
+            return prefix_len < MAX_PREFIX ? prefix_len : MAX_PREFIX;
+        }
+
+        // prefix_matches: optimistic check of the stored prefix bytes
+        static bool prefix_matches(const Node *n, const char *key, std::size_t len, std::size_t depth) {
+            for (std::size_t i = 0; i < stored(n->prefix_len); i++) {
+                if (n->prefix[i] != byte(key, len, depth + i)) return false;
+            }
+            return true;
+        }
+
+        // prefix_mismatch: index of the first byte of the full prefix
+        // of n that differs from key, prefix_len if none does
+        static uint32_t prefix_mismatch(Node *n, const char *key, std::size_t len, std::size_t depth) {
+            uint32_t i = 0;
+            for (; i < stored(n->prefix_len); i++) {
+                if (n->prefix[i] != byte(key, len, depth + i)) return i;
+            }
+            if (n->prefix_len > MAX_PREFIX) {
+                Leaf *l = minimum(n);
+                for (; i < n->prefix_len; i++) {
+                    if (byte(l->key, l->len, depth + i) != byte(key, len, depth + i)) return i;
+                }
+            }
+            return i;
+        }
+
+        template <class F>
+        void atomically(F &&fn, TSXStats *stats) {
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                fn();
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                fn();
+            }
+        }
+
+        // take: hands out a spare node of the given type,
+        // or records that one is needed
+        static Node *take(Node **spares, int type, int &need) {
+            Node *n = spares[type];
+            if (!n) need = type;
+            spares[type] = nullptr;
+            return n;
+        }
+
+        Outcome insert_tx(Leaf *leaf, bool assign, Node **spares, int &need, Node *&replaced) {
+            const char *key = leaf->key;
+            const std::size_t len = leaf->len;
+            Node **ref = &root;
+            std::size_t depth = 0;
+
+            for (;;) {
+                Node *n = *ref;
+                if (!n) {
+                    *ref = leaf;
+                    return DONE;
+                }
+
+                if (n->type == LEAF) {
+                    Leaf *existing = static_cast<Leaf *>(n);
+                    if (leaf_matches(existing, key, len)) {
+                        if (assign) existing->value = leaf->value;
+                        return EXISTS;
+                    }
+                    // lazy expansion, split the leaf at the first differing byte
+                    Node *split = take(spares, NODE4, need);
+                    if (!split) return NEED;
+                    std::size_t common = 0;
+                    const std::size_t longest = existing->len > len ? existing->len : len;
+                    while (depth + common < longest &&
+                           byte(existing->key, existing->len, depth + common) == byte(key, len, depth + common)) {
+                        common++;
+                    }
+                    split->prefix_len = common;
+                    for (std::size_t i = 0; i < stored(common); i++) split->prefix[i] = byte(key, len, depth + i);
+                    add_child(split, byte(existing->key, existing->len, depth + common), existing);
+                    add_child(split, byte(key, len, depth + common), leaf);
+                    *ref = split;
+                    return DONE;
+                }
+
+                uint32_t mismatch = prefix_mismatch(n, key, len, depth);
+                if (mismatch < n->prefix_len) {
+                    // path compression, split the prefix of n
+                    Node *split = take(spares, NODE4, need);
+                    if (!split) return NEED;
+                    split->prefix_len = mismatch;
+                    std::memcpy(split->prefix, n->prefix, stored(mismatch));
+
+                    uint8_t b;
+                    if (n->prefix_len <= MAX_PREFIX) {
+                        b = n->prefix[mismatch];
+                        n->prefix_len -= mismatch + 1;
+                        std::memmove(n->prefix, n->prefix + mismatch + 1, stored(n->prefix_len));
+                    } else {
+                        Leaf *l = minimum(n);
+                        b = byte(l->key, l->len, depth + mismatch);
+                        n->prefix_len -= mismatch + 1;
+                        for (std::size_t i = 0; i < stored(n->prefix_len); i++) {
+                            n->prefix[i] = byte(l->key, l->len, depth + mismatch + 1 + i);
+                        }
+                    }
+                    add_child(split, b, n);
+                    add_child(split, byte(key, len, depth + mismatch), leaf);
+                    *ref = split;
+                    return DONE;
+                }
+
+                depth += n->prefix_len;
+                uint8_t b = byte(key, len, depth);
+                Node **child = find_child(n, b);
+                if (child) {
+                    ref = child;
+                    depth++;
+                    continue;
+                }
+
+                if (full(n)) {
+                    Node *grown = take(spares, n->type + 1, need);
+                    if (!grown) return NEED;
+                    transfer(n, grown);
+                    *ref = grown;
+                    replaced = n;
+                    n = grown;
+                }
+                add_child(n, b, leaf);
+                return DONE;
+            }
+        }
+
+        Outcome erase_tx(const char *key, std::size_t len, Node **spares, int &need, Node **freed) {
+            Node **ref = &root, **parent_ref = nullptr;
+            Node *parent = nullptr;
+            uint8_t parent_byte = 0;
+            std::size_t depth = 0;
+
+            for (;;) {
+                Node *n = *ref;
+                if (!n) return ABSENT;
+
+                if (n->type != LEAF) {
+                    if (!prefix_matches(n, key, len, depth)) return ABSENT;
+                    depth += n->prefix_len;
+                    uint8_t b = byte(key, len, depth);
+                    Node **child = find_child(n, b);
+                    if (!child) return ABSENT;
+                    parent_ref = ref;
+                    parent = n;
+                    parent_byte = b;
+                    ref = child;
+                    depth++;
+                    continue;
+                }
+
+                if (!leaf_matches(static_cast<Leaf *>(n), key, len)) return ABSENT;
+                if (!parent) {
+                    root = nullptr;
+                    freed[0] = n;
+                    return DONE;
+                }
+
+                int smaller = -1;
+                if (parent->type == NODE16 && parent->count == 4) smaller = NODE4;
+                else if (parent->type == NODE48 && parent->count == 13) smaller = NODE16;
+                else if (parent->type == NODE256 && parent->count == 38) smaller = NODE48;
+
+                if (parent->type == NODE4 && parent->count == 2) {
+                    // a Node4 with one child left is replaced by it,
+                    // its prefix and key byte move into the child
+                    remove_child(parent, parent_byte);
+                    Node4 *p = static_cast<Node4 *>(parent);
+                    Node *other = p->children[0];
+                    if (other->type != LEAF) {
+                        std::size_t prefix = p->prefix_len;
+                        if (prefix < MAX_PREFIX) p->prefix[prefix++] = p->keys[0];
+                        if (prefix < MAX_PREFIX) {
+                            std::size_t sub = stored(other->prefix_len);
+                            if (sub > MAX_PREFIX - prefix) sub = MAX_PREFIX - prefix;
+                            std::memcpy(p->prefix + prefix, other->prefix, sub);
+                            prefix += sub;
+                        }
+                        std::memcpy(other->prefix, p->prefix, stored(prefix));
+                        other->prefix_len += p->prefix_len + 1;
+                    }
+                    *parent_ref = other;
+                    freed[1] = parent;
+                } else if (smaller >= 0) {
+                    Node *shrunk = take(spares, smaller, need);
+                    if (!shrunk) return NEED;
+                    remove_child(parent, parent_byte);
+                    transfer(parent, shrunk);
+                    *parent_ref = shrunk;
+                    freed[1] = parent;
+                } else {
+                    remove_child(parent, parent_byte);
+                }
+                freed[0] = n;
+                return DONE;
+            }
+        }
+
+        bool insert_impl(const char *key, std::size_t len, const V &value, bool assign, TSXStats *stats) {
+            Leaf *leaf = allocate_leaf(key, len, value);
+            Node *spares[TYPES] = {};
+            Outcome outcome = NEED;
+            Node *replaced = nullptr;
+
+            while (outcome == NEED) {
+                int need = LEAF;
+                atomically([&]() {
+                    replaced = nullptr;
+                    outcome = insert_tx(leaf, assign, spares, need, replaced);
+                }, stats);
+                if (outcome == NEED) spares[need] = allocate_node(need);
+            }
+
+            for (int t = NODE4; t < TYPES; t++) std::free(spares[t]);
+            std::free(replaced);
+            if (outcome == EXISTS) std::free(leaf);
+            return outcome == DONE;
+        }
+
+        bool erase_impl(const char *key, std::size_t len, TSXStats *stats) {
+            Node *spares[TYPES] = {};
+            Node *freed[2] = { nullptr, nullptr };
+            Outcome outcome = NEED;
+
+            while (outcome == NEED) {
+                int need = LEAF;
+                atomically([&]() {
+                    freed[0] = freed[1] = nullptr;
+                    outcome = erase_tx(key, len, spares, need, freed);
+                }, stats);
+                if (outcome == NEED) spares[need] = allocate_node(need);
+            }
+
+            for (int t = NODE4; t < TYPES; t++) std::free(spares[t]);
+            std::free(freed[0]);
+            std::free(freed[1]);
+            return outcome == DONE;
+        }
+
+        static std::size_t count_leaves(Node *n) {
+            if (!n) return 0;
+            if (n->type == LEAF) return 1;
+            std::size_t count = 0;
+            for_each_child(n, [&count](uint8_t, Node *child) { count += count_leaves(child); });
+            return count;
+        }
+
+    public:
+        explicit RadixTree(int max_tx_retries = machine_profile().max_retries):
+        root(nullptr),
+        max_retries(max_tx_retries)
+        {}
+
+        ~RadixTree() {
+            free_subtree(root);
+        }
+
+        // find: copies the value of key into value,
+        // returns false if key is not in the tree.
+        // Reads only, lookups never conflict with each other.
+        bool find(const char *key, std::size_t len, V &value, TSXStats *stats = nullptr) {
+            bool found = false;
+            atomically([&]() {
+                Node *n = root;
+                std::size_t depth = 0;
+                while (n) {
+                    if (n->type == LEAF) {
+                        found = leaf_matches(static_cast<Leaf *>(n), key, len);
+                        if (found) value = static_cast<Leaf *>(n)->value;
+                        return;
+                    }
+                    if (!prefix_matches(n, key, len, depth)) return;
+                    depth += n->prefix_len;
+                    Node **child = find_child(n, byte(key, len, depth));
+                    if (!child) return;
+                    n = *child;
+                    depth++;
+                }
+            }, stats);
+            return found;
+        }
+
+        bool find(const std::string &key, V &value, TSXStats *stats = nullptr) {
+            return find(key.data(), key.size(), value, stats);
+        }
+
+        bool contains(const std::string &key, TSXStats *stats = nullptr) {
+            V value;
+            return find(key.data(), key.size(), value, stats);
+        }
+
+        // insert: adds key if it is not in the tree yet,
+        // returns false (leaving the tree unchanged) otherwise
+        bool insert(const char *key, std::size_t len, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key, len, value, false, stats);
+        }
+
+        bool insert(const std::string &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key.data(), key.size(), value, false, stats);
+        }
+
+        // insert_or_assign: adds key or overwrites its value,
+        // returns true if key was added
+        bool insert_or_assign(const std::string &key, const V &value, TSXStats *stats = nullptr) {
+            return insert_impl(key.data(), key.size(), value, true, stats);
+        }
+
+        // erase: removes key, returns false if it was not in the tree
+        bool erase(const char *key, std::size_t len, TSXStats *stats = nullptr) {
+            return erase_impl(key, len, stats);
+        }
+
+        bool erase(const std::string &key, TSXStats *stats = nullptr) {
+            return erase_impl(key.data(), key.size(), stats);
+        }
+
+        // size: number of keys. Visits every node in one critical
+        // section, which will usually take the fall-back lock.
+        std::size_t size(TSXStats *stats = nullptr) {
+            std::size_t count = 0;
+            atomically([&]() {
+                count = count_leaves(root);
+            }, stats);
+            return count;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef INCLUDE_TSX_SKIP_LIST_HPP
+
+    #define INCLUDE_TSX_SKIP_LIST_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <type_traits>
+
+#include "TSXEpoch.hpp"
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+
+namespace TSX {
+
+    // SkipList: ordered set of keys with values.
+    //
+    // Inserts and erases search for the predecessors of
+    // the key outside of any transaction, then validate them
+    // and splice the node into (or out of) all of its levels
+    // in one TSXGuard, so a node is never half linked to
+    // another writer and no multi-word CAS is needed.
+    //
+    // Lookups take no guard at all. They only follow next
+    // pointers, which writers publish with release stores
+    // after the node is fully initialized, bottom level
+    // first. In a transaction all stores become visible at
+    // once, under the fall-back lock that order keeps every
+    // intermediate state a valid skip list. Erased nodes keep
+    // their next pointers, so a reader standing on one still
+    // reaches the rest of the list.
+    //
+    // Since readers are not transactional, erased nodes cannot
+    // be freed while one may still be reading them. Every
+    // operation pins the Epoch, erased nodes are retired to it.
+    template <class K, class V, class Compare = std::less<K> >
+    class SkipList {
+        static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "SkipList keys and values must be trivially copyable");
+
+    public:
+        static constexpr int MAX_LEVEL = 24;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Node {
+            K key;
+            V value;                    // immutable once published
+            int height;
+            std::atomic<bool> deleted;
+            std::atomic<Node *> next[1];    // height entries
+        };
+
+        alignas(ALIGNMENT) Node *head;
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+        Compare less;
+
+        SkipList(const SkipList &) = delete;
+        SkipList &operator=(const SkipList &) = delete;
+
+        enum Outcome { DONE, ABSENT, RETRY };
+
+        static Node *allocate_node(const K &key, const V &value, int height) {
+            std::size_t bytes = sizeof(Node) + (height - 1) * sizeof(std::atomic<Node *>);
+            void *mem = allocate_aligned(CACHE_LINE_SIZE, bytes);
+            Node *n = static_cast<Node *>(mem);
+            n->key = key;
+            n->value = value;
+            n->height = height;
+            n->deleted.store(false, std::memory_order_relaxed);
+            for (int i = 0; i < height; i++) new (&n->next[i]) std::atomic<Node *>(nullptr);
+            return n;
+        }
+
+        static int random_height() {
+            static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            // geometric with p = 1/2
+            int height = 1 + __builtin_ctzll(state | (1ull << (MAX_LEVEL - 1)));
+            return height;
+        }
+
+        // search: fills the predecessors and successors of key
+        // on every level, outside of any transaction
+        void search(const K &key, Node **preds, Node **succs) const {
+            Node *pred = head;
+            for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+                Node *cur = pred->next[i].load(std::memory_order_acquire);
+                while (cur && less(cur->key, key)) {
+                    pred = cur;
+                    cur = pred->next[i].load(std::memory_order_acquire);
+                }
+                preds[i] = pred;
+                succs[i] = cur;
+            }
+        }
+
+        bool matches(const Node *n, const K &key) const {
+            return n && !less(key, n->key) && !n->deleted.load(std::memory_order_acquire);
+        }
+
+        static void free_node(void *n) {
+            std::free(n);
+        }
+
+    public:
+        explicit SkipList(int max_tx_retries = machine_profile().max_retries):
+        head(allocate_node(K(), V(), MAX_LEVEL)),
+        max_retries(max_tx_retries)
+        {}
+
+        ~SkipList() {
+            Node *n = head;
+            while (n) {
+                Node *next = n->next[0].load();
+                std::free(n);
+                n = next;
+            }
+        }
+
+        // find: copies the value of key into value,
+        // returns false if key is not in the list.
+        // Never starts a transaction or takes the lock.
+        bool find(const K &key, V &value) const {
+            Epoch::Pin pin;
+            Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+            search(key, preds, succs);
+            if (!matches(succs[0], key)) return false;
+            value = succs[0]->value;
+            return true;
+        }
+
+        bool contains(const K &key) const {
+            V value;
+            return find(key, value);
+        }
+
+        // insert: adds key if it is not in the list yet,
+        // returns false (leaving the list unchanged) otherwise
+        bool insert(const K &key, const V &value) {
+            Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+            const int height = random_height();
+            Node *fresh = allocate_node(key, value, height);
+            Epoch::Pin pin;
+
+            for (;;) {
+                search(key, preds, succs);
+                if (matches(succs[0], key)) {
+                    std::free(fresh);
+                    return false;
+                }
+
+                Outcome outcome = RETRY;
+                {
+                    unsigned char status = 0;
+                    TSXGuard guard(max_retries, lock, status);
+
+                    bool valid = true;
+                    for (int i = 0; i < height && valid; i++) {
+                        valid = !preds[i]->deleted.load(std::memory_order_relaxed) &&
+                            preds[i]->next[i].load(std::memory_order_relaxed) == succs[i];
+                    }
+                    if (valid) {
+                        for (int i = 0; i < height; i++) {
+                            fresh->next[i].store(succs[i], std::memory_order_relaxed);
+                        }
+                        // bottom up, the node is reachable
+                        // from level 0 before any level above it
+                        for (int i = 0; i < height; i++) {
+                            preds[i]->next[i].store(fresh, std::memory_order_release);
+                        }
+                        outcome = DONE;
+                    }
+                }
+
+                if (outcome == DONE) return true;
+            }
+        }
+
+        // erase: removes key, returns false if it was not in the list
+        bool erase(const K &key) {
+            Epoch::Pin pin;
+            Node *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+
+            for (;;) {
+                search(key, preds, succs);
+                Node *victim = succs[0];
+                if (!matches(victim, key)) return false;
+
+                Outcome outcome = RETRY;
+                {
+                    unsigned char status = 0;
+                    TSXGuard guard(max_retries, lock, status);
+
+                    if (victim->deleted.load(std::memory_order_relaxed)) {
+                        outcome = ABSENT;
+                    } else {
+                        bool valid = true;
+                        for (int i = 0; i < victim->height && valid; i++) {
+                            valid = !preds[i]->deleted.load(std::memory_order_relaxed) &&
+                                preds[i]->next[i].load(std::memory_order_relaxed) == victim;
+                        }
+                        if (valid) {
+                            victim->deleted.store(true, std::memory_order_release);
+                            // top down, the node stays reachable
+                            // from level 0 until it is fully unlinked
+                            for (int i = victim->height - 1; i >= 0; i--) {
+                                preds[i]->next[i].store(victim->next[i].load(std::memory_order_relaxed),
+                                    std::memory_order_release);
+                            }
+                            outcome = DONE;
+                        }
+                    }
+                }
+
+                if (outcome == ABSENT) return false;
+                if (outcome == DONE) {
+                    Epoch::retire(victim, free_node);
+                    return true;
+                }
+            }
+        }
+
+        // for_each: calls fn(key, value) for every key in
+        // order. Not a snapshot, like find it runs without
+        // synchronization and sees concurrent updates or not.
+        template <class F>
+        void for_each(F fn) const {
+            Epoch::Pin pin;
+            for (Node *n = head->next[0].load(std::memory_order_acquire); n;
+                 n = n->next[0].load(std::memory_order_acquire)) {
+                if (!n->deleted.load(std::memory_order_acquire)) fn(n->key, n->value);
+            }
+        }
+    };
+
+};
+
+#endif
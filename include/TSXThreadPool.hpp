@@ -0,0 +1,310 @@
+#ifndef INCLUDE_TSX_THREAD_POOL_HPP
+
+    #define INCLUDE_TSX_THREAD_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "TSXGuard.hpp"
+#include "TSXProfile.hpp"
+#include "TSXBoundedQueue.hpp"
+
+namespace TSX {
+
+    // WorkStealingDeque: deque owned by one thread that pushes
+    // and pops at the bottom, other threads steal from the top.
+    //
+    // The items are split in a public part [top, split), which
+    // thieves steal from in small TSXGuard transactions, and a
+    // private part [split, bottom) that only the owner touches.
+    // Owner push and pop work on the private part with plain loads
+    // and stores, no fence, CAS or transaction. When the public
+    // part runs dry the owner publishes half of its private items
+    // by moving split up with a release store. When the private
+    // part runs dry the owner takes back half of the public items
+    // (or the last one) in a transaction, which is where it can
+    // race with thieves.
+    //
+    // The capacity is fixed, push returns false when it is full.
+    template <class T>
+    class WorkStealingDeque {
+        static_assert(std::is_trivially_copyable<T>::value,
+        "WorkStealingDeque items are copied inside transactions and must be trivially copyable");
+
+    private:
+        alignas(ALIGNMENT) std::atomic<std::size_t> top;     // written by thieves
+        alignas(ALIGNMENT) std::atomic<std::size_t> split;   // written by the owner
+        alignas(ALIGNMENT) std::size_t bottom;               // owner only
+        std::size_t owner_split;                             // owner copy of split
+        T *slots;
+        const std::size_t mask;
+        alignas(ALIGNMENT) SpinLock lock;
+        const int max_retries;
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        // publish: hands half of the private items to
+        // thieves once they have stolen all public ones
+        void publish() {
+            if (bottom - owner_split < 2 || top.load(std::memory_order_relaxed) != owner_split) return;
+            owner_split += (bottom - owner_split) / 2;
+            split.store(owner_split, std::memory_order_release);
+        }
+
+        // reclaim: takes back the newer half of the public items
+        bool reclaim(TSXStats *stats) {
+            std::size_t new_split = owner_split;
+            {
+                unsigned char status = 0;
+                if (stats) {
+                    TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                    new_split = reclaim_split();
+                } else {
+                    TSXGuard guard(max_retries, lock, status);
+                    new_split = reclaim_split();
+                }
+            }
+            if (new_split == owner_split) return false;
+            owner_split = new_split;
+            return true;
+        }
+
+        std::size_t reclaim_split() {
+            std::size_t t = top.load(std::memory_order_relaxed);
+            std::size_t s = split.load(std::memory_order_relaxed);
+            if (t == s) return s;
+            s = t + (s - t) / 2;
+            split.store(s, std::memory_order_relaxed);
+            return s;
+        }
+
+        std::size_t steal_one(T &item) {
+            std::size_t t = top.load(std::memory_order_relaxed);
+            if (t == split.load(std::memory_order_acquire)) return 0;
+            item = slots[t & mask];
+            top.store(t + 1, std::memory_order_relaxed);
+            return 1;
+        }
+
+    public:
+        explicit WorkStealingDeque(std::size_t capacity = 1024, int max_tx_retries = machine_profile().max_retries):
+        top(0),
+        split(0),
+        bottom(0),
+        owner_split(0),
+        slots(nullptr),
+        mask([capacity]() { std::size_t size = 1; while (size < capacity) size <<= 1; return size - 1; }()),
+        max_retries(max_tx_retries)
+        {
+            void *mem = allocate_aligned(ALIGNMENT, (mask + 1) * sizeof(T));
+            slots = static_cast<T *>(mem);
+        }
+
+        ~WorkStealingDeque() {
+            std::free(slots);
+        }
+
+        // push: owner only, returns false if the deque is full
+        bool push(const T &item) {
+            // a stale top only makes the deque look fuller
+            if (bottom - top.load(std::memory_order_relaxed) > mask) return false;
+            slots[bottom & mask] = item;
+            bottom++;
+            publish();
+            return true;
+        }
+
+        // pop: owner only, newest item first
+        bool pop(T &item, TSXStats *stats = nullptr) {
+            if (bottom == owner_split) {
+                // the reclaimed items become [owner_split, bottom)
+                if (!reclaim(stats)) return false;
+            }
+            item = slots[--bottom & mask];
+            publish();
+            return true;
+        }
+
+        // steal: any thread, oldest item first
+        bool steal(T &item, TSXStats *stats = nullptr) {
+            std::size_t taken = 0;
+            unsigned char status = 0;
+            if (stats) {
+                TSXGuardWithStats guard(max_retries, lock, status, *stats);
+                taken = steal_one(item);
+            } else {
+                TSXGuard guard(max_retries, lock, status);
+                taken = steal_one(item);
+            }
+            return taken != 0;
+        }
+
+        // size: items in the deque, approximate unless
+        // called by the owner with no thieves around
+        std::size_t size() const {
+            std::size_t t = top.load(std::memory_order_relaxed);
+            std::size_t b = bottom;
+            return b > t ? b - t : 0;
+        }
+    };
+
+    // ThreadPool: fixed set of workers, each with a
+    // WorkStealingDeque of tasks.
+    //
+    // Tasks submitted from a worker go to its own deque, tasks
+    // submitted from other threads to a shared BoundedQueue.
+    // Idle workers take from their deque, then from the shared
+    // queue, then steal from the other workers, and finally sleep
+    // for up to a millisecond (or until a task is submitted).
+    class ThreadPool {
+    public:
+        typedef std::function<void()> Task;
+
+    private:
+        struct Worker: AlignedNew<ALIGNMENT> {
+            WorkStealingDeque<Task *> deque;
+            std::thread thread;
+
+            Worker(std::size_t capacity, int max_retries): deque(capacity, max_retries) {}
+        };
+
+        struct Current {
+            ThreadPool *pool;
+            int worker;
+        };
+
+        BoundedQueue<Task *> injected;
+        std::vector<std::unique_ptr<Worker> > workers;
+        std::atomic<long> pending;
+        std::atomic<int> sleepers;
+        std::atomic<bool> stopping;
+        std::mutex idle_mutex;
+        std::condition_variable idle_cv;
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        static Current &current() {
+            static thread_local Current c = { nullptr, -1 };
+            return c;
+        }
+
+        static unsigned next_random() {
+            static thread_local uint32_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        bool steal_any(Task *&task, int self) {
+            const int n = workers.size();
+            const int start = next_random() % n;
+            for (int i = 0; i < n; i++) {
+                int victim = (start + i) % n;
+                if (victim != self && workers[victim]->deque.steal(task)) return true;
+            }
+            return false;
+        }
+
+        void run_task(Task *task) {
+            (*task)();
+            delete task;
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        void work(int id) {
+            current().pool = this;
+            current().worker = id;
+            WorkStealingDeque<Task *> &own = workers[id]->deque;
+
+            for (;;) {
+                Task *task = nullptr;
+                if (own.pop(task) || injected.dequeue(task) || steal_any(task, id)) {
+                    run_task(task);
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire)) return;
+
+                std::unique_lock<std::mutex> idle(idle_mutex);
+                sleepers.fetch_add(1);
+                idle_cv.wait_for(idle, std::chrono::milliseconds(1));
+                sleepers.fetch_sub(1);
+            }
+        }
+
+    public:
+        explicit ThreadPool(int threads = std::thread::hardware_concurrency(),
+                            std::size_t deque_capacity = 1024,
+                            int max_tx_retries = machine_profile().max_retries):
+        injected(deque_capacity, max_tx_retries),
+        pending(0),
+        sleepers(0),
+        stopping(false)
+        {
+            if (threads < 1) threads = 1;
+            for (int i = 0; i < threads; i++) {
+                workers.push_back(std::unique_ptr<Worker>(new Worker(deque_capacity, max_tx_retries)));
+            }
+            for (int i = 0; i < threads; i++) {
+                workers[i]->thread = std::thread(&ThreadPool::work, this, i);
+            }
+        }
+
+        ~ThreadPool() {
+            wait();
+            stopping.store(true, std::memory_order_release);
+            idle_cv.notify_all();
+            for (std::unique_ptr<Worker> &w : workers) w->thread.join();
+        }
+
+        int threads() const { return workers.size(); }
+
+        // submit: schedules fn. From a worker the task goes to the
+        // front of its own deque, or runs right away if it is full.
+        template <class F>
+        void submit(F &&fn) {
+            Task *task = new Task(std::forward<F>(fn));
+            pending.fetch_add(1, std::memory_order_acq_rel);
+
+            Current &c = current();
+            if (c.pool == this) {
+                if (!workers[c.worker]->deque.push(task)) run_task(task);
+            } else {
+                while (!injected.enqueue(task)) std::this_thread::yield();
+            }
+            if (sleepers.load(std::memory_order_relaxed) > 0) idle_cv.notify_one();
+        }
+
+        // wait: returns once every submitted task, and every task
+        // they submitted, has run. The caller helps running them.
+        void wait() {
+            while (pending.load(std::memory_order_acquire) != 0) {
+                Task *task = nullptr;
+                Current &c = current();
+                if (c.pool == this && workers[c.worker]->deque.pop(task)) {
+                    run_task(task);
+                } else if (injected.dequeue(task) || steal_any(task, c.pool == this ? c.worker : -1)) {
+                    run_task(task);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXBPlusTree.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("BPlusTree TEST", "[bplustree]") {
+    // small nodes, so a few thousand keys build a deep tree
+    TSX::BPlusTree<long, long> tree(4);
+    const long N = 5000;
+
+    for (long i = 0; i < N; i++) {
+        long key = (i * 7919) % N;
+        REQUIRE(tree.insert(key, key * 2));
+    }
+    REQUIRE_FALSE(tree.insert(10, 0));
+    REQUIRE(tree.verify());
+    REQUIRE(tree.size() == N);
+
+    long value = 0;
+    REQUIRE(tree.find(10, value));
+    REQUIRE(value == 20);
+
+    REQUIRE_FALSE(tree.insert_or_assign(10, 11));
+    REQUIRE(tree.find(10, value));
+    REQUIRE(value == 11);
+
+    long expected = 100;
+    REQUIRE(tree.range(100, 299, [&](long k, long) {
+        REQUIRE(k == expected);
+        expected++;
+    }) == 200);
+
+    for (long i = 0; i < N; i += 3) {
+        REQUIRE(tree.erase(i));
+    }
+    REQUIRE_FALSE(tree.erase(0));
+    REQUIRE(tree.verify());
+
+    for (long i = 0; i < N; i++) {
+        REQUIRE(tree.contains(i) == (i % 3 != 0));
+    }
+
+    // emptying the tree merges it back into a single leaf
+    for (long i = 0; i < N; i++) {
+        tree.erase(i);
+    }
+    REQUIRE(tree.verify());
+    REQUIRE(tree.size() == 0);
+    REQUIRE(tree.insert(1, 1));
+}
+
+TEST_CASE("BPlusTree fill TEST", "[bplustree]") {
+    // mixed inserts and erases leave underfull nodes next to
+    // siblings too full to merge with, which have to lend them keys
+    for (int fanout = 4; fanout <= 9; fanout++) {
+        TSX::BPlusTree<long, long> tree(fanout);
+        const long N = 2000;
+        std::vector<bool> present(N, false);
+        unsigned long long state = 88172645463325252ull + fanout;
+        for (long i = 0; i < 20 * N; i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            long key = state % N;
+            // grow first, then shrink
+            if ((i < 10 * N) == (state / N % 3 != 0)) {
+                REQUIRE(tree.insert(key, key) == !present[key]);
+                present[key] = true;
+            } else {
+                REQUIRE(tree.erase(key) == present[key]);
+                present[key] = false;
+            }
+            if (i % 199 == 0) REQUIRE(tree.verify());
+        }
+        REQUIRE(tree.verify());
+        for (long i = 0; i < N; i++) REQUIRE(tree.contains(i) == present[i]);
+    }
+}
+
+void bplustree_worker(TSX::BPlusTree<long, long> &tree, int tid, long n) {
+    for (long i = tid; i < n; i += THREADS) {
+        tree.insert(i, i);
+    }
+    for (long i = tid; i < n; i += THREADS) {
+        if (i % 2 == 0) tree.erase(i);
+    }
+}
+
+TEST_CASE("BPlusTree Concurrent TEST", "[bplustree]") {
+    TSX::BPlusTree<long, long> tree(8);
+    const long N = 20000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(bplustree_worker, std::ref(tree), i, N);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(tree.verify());
+    REQUIRE(tree.size() == N / 2);
+
+    long expected = 1;
+    tree.range(0, N, [&](long k, long v) {
+        REQUIRE(k == expected);
+        REQUIRE(v == k);
+        expected += 2;
+    });
+    REQUIRE(expected == N + 1);
+}
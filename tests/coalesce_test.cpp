@@ -0,0 +1,82 @@
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXCoalesce.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("Coalescer TEST", "[coalesce]") {
+    TSX::SpinLock spin_lock;
+    TSX::Coalescer batch(spin_lock, 8);
+    REQUIRE(batch.width() >= 1);
+    REQUIRE(batch.width() <= 8);
+
+    std::vector<long> order;
+    batch.run(100, [&](std::size_t i) { order.push_back(i); });
+    // push_back may allocate and abort a batch, every section still runs once
+    REQUIRE(order.size() == 100);
+    for (std::size_t i = 0; i < order.size(); i++) REQUIRE(order[i] == static_cast<long>(i));
+    REQUIRE(batch.width() >= 1);
+    REQUIRE(batch.width() <= 8);
+    REQUIRE_FALSE(spin_lock.isLocked());
+
+    long values[16] = {0};
+    batch.run(0, [&](std::size_t i) { values[i]++; });
+    batch.run(16, [&](std::size_t i) { values[i] += i; });
+    for (long i = 0; i < 16; i++) REQUIRE(values[i] == i);
+
+    // commit actions of nested guards run once per section
+    long committed = 0;
+    batch.run(10, [&](std::size_t) {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        guard.on_commit([&committed]() { committed++; });
+    });
+    REQUIRE(committed == 10);
+    REQUIRE(TSX::guard_actions().count == 0);
+
+    // inside a guard the sections join it
+    long sum = 0;
+    {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        batch.run(5, [&](std::size_t i) { sum += i; });
+    }
+    REQUIRE(sum == 10);
+    REQUIRE_FALSE(spin_lock.isLocked());
+
+    TSX::Coalescer single(spin_lock, 1);
+    REQUIRE(single.width() == 1);
+    single.run(3, [&](std::size_t) { sum++; });
+    REQUIRE(sum == 13);
+}
+
+// every section adds one to a counter shared by all the
+// threads and to the total, in batches of sections
+void coalesce_worker(TSX::SpinLock &spin_lock, long *counters, long &total, int count) {
+    TSX::Coalescer batch(spin_lock);
+    batch.run(count, [&](std::size_t i) {
+        counters[i % 64]++;
+        total++;
+    });
+}
+
+TEST_CASE("Coalescer Concurrent TEST", "[coalesce]") {
+    TSX::SpinLock spin_lock;
+    long counters[64] = {0};
+    long total = 0;
+    const int COUNT = 64 * 1000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(coalesce_worker, std::ref(spin_lock), counters, std::ref(total), COUNT);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(total == THREADS * COUNT);
+    for (int i = 0; i < 64; i++) REQUIRE(counters[i] == THREADS * 1000);
+}
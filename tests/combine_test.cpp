@@ -0,0 +1,124 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXCombine.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("Combiner TEST", "[combine]") {
+    TSX::SpinLock spin_lock;
+    TSX::Combiner combiner(spin_lock);
+
+    long value = 0;
+    for (int i = 0; i < 100; i++) combiner.execute([&value]() { value++; });
+    REQUIRE(value == 100);
+    REQUIRE_FALSE(spin_lock.isLocked());
+
+    // allocates, which aborts the transaction, so it is combined
+    std::vector<long> items;
+    for (long i = 0; i < 100; i++) combiner.execute([&items, i]() { items.push_back(i); });
+    REQUIRE(items.size() == 100);
+    for (long i = 0; i < 100; i++) REQUIRE(items[i] == i);
+
+    // commit actions of nested guards run once per operation
+    long committed = 0;
+    for (int i = 0; i < 10; i++) {
+        combiner.execute([&]() {
+            unsigned char status = 0;
+            TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+            guard.on_commit([&committed]() { committed++; });
+        });
+    }
+    REQUIRE(committed == 10);
+
+    // inside a guard the operation joins it
+    {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        combiner.execute([&value]() { value++; });
+    }
+    REQUIRE(value == 101);
+    REQUIRE_FALSE(spin_lock.isLocked());
+
+    TSX::Combiner *heap = new TSX::Combiner(spin_lock, 0);
+    heap->execute([&value]() { value++; });
+    delete heap;
+    REQUIRE(value == 102);
+}
+
+// operations of other threads may run on this one and the other way
+// round, each exactly once, mixed with plain guards on the same lock
+void combine_worker(TSX::Combiner &combiner, TSX::SpinLock &spin_lock, std::vector<long> &items,
+                    long &total, long &mine, int count) {
+    for (int i = 0; i < count; i++) {
+        if (i % 4 == 0) {
+            unsigned char status = 0;
+            TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+            total++;
+            mine++;
+        } else {
+            combiner.execute([&items, &total, &mine, i]() {
+                if (i % 2) items.push_back(i);
+                total++;
+                mine++;
+            });
+        }
+    }
+}
+
+TEST_CASE("Combiner Concurrent TEST", "[combine]") {
+    TSX::SpinLock spin_lock;
+    TSX::Combiner combiner(spin_lock);
+    std::vector<long> items;
+    long total = 0;
+    long mine[THREADS] = {0};
+    const int COUNT = 20000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(combine_worker, std::ref(combiner), std::ref(spin_lock), std::ref(items),
+                                 std::ref(total), std::ref(mine[i]), COUNT);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(total == THREADS * COUNT);
+    for (int i = 0; i < THREADS; i++) REQUIRE(mine[i] == COUNT);
+    REQUIRE(items.size() == static_cast<std::size_t>(THREADS * COUNT / 2));
+    REQUIRE_FALSE(spin_lock.isLocked());
+}
+
+TEST_CASE("Combiner slots TEST", "[combine]") {
+    TSX::SpinLock spin_lock;
+    TSX::Combiner combiner(spin_lock);
+    std::vector<long> items;
+    std::atomic<int> ready(0);
+    std::atomic<bool> release(false);
+
+    // allocating aborts, so every thread takes a slot, and
+    // keeps it until it exits
+    std::vector<std::thread> threads;
+    for (int i = 0; i < TSX::Combiner::MAX_THREADS; i++) {
+        threads.push_back(std::thread([&, i]() {
+            combiner.execute([&items, i]() { items.push_back(i); });
+            ready++;
+            while (!release) std::this_thread::yield();
+        }));
+    }
+    while (ready != TSX::Combiner::MAX_THREADS) std::this_thread::yield();
+
+    // a thread without a slot runs under the lock
+    std::thread extra([&]() {
+        for (long i = 0; i < 10; i++) combiner.execute([&items, i]() { items.push_back(i); });
+    });
+    extra.join();
+    release = true;
+    for (std::thread &t : threads) t.join();
+
+    REQUIRE(items.size() == static_cast<std::size_t>(TSX::Combiner::MAX_THREADS + 10));
+    REQUIRE_FALSE(spin_lock.isLocked());
+}
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXEpoch.hpp"
+#include "../include/TSXProfile.hpp"
+
+static const int THREADS = 4;
+
+static const long ALIVE = 0x5eed;
+
+struct Tracked {
+    static std::atomic<long> destroyed;
+    long check;
+
+    Tracked(): check(ALIVE) {}
+
+    ~Tracked() {
+        check = 0;
+        destroyed++;
+    }
+};
+
+std::atomic<long> Tracked::destroyed(0);
+
+static void reclaim() {
+    for (int i = 0; i < 3; i++) TSX::Epoch::flush();
+}
+
+TEST_CASE("Epoch TEST", "[epoch]") {
+    Tracked::destroyed = 0;
+    reclaim();
+
+    for (int i = 0; i < 10; i++) TSX::Epoch::retire(new Tracked());
+    reclaim();
+    REQUIRE(Tracked::destroyed == 10);
+
+    // a pinned thread keeps what is retired from then on
+    std::atomic<int> stage(0);
+    std::thread reader([&]() {
+        TSX::Epoch::Pin pin;
+        stage = 1;
+        while (stage != 2) std::this_thread::yield();
+    });
+    while (stage != 1) std::this_thread::yield();
+
+    for (int i = 0; i < 10; i++) TSX::Epoch::retire(new Tracked());
+    reclaim();
+    reclaim();
+    REQUIRE(Tracked::destroyed == 10);
+
+    stage = 2;
+    reader.join();
+    reclaim();
+    REQUIRE(Tracked::destroyed == 20);
+
+    // retired in a guard, queued when the pin is released
+    TSX::SpinLock lock;
+    {
+        unsigned char status = 0;
+        TSX::EpochGuard guard(TSX::machine_profile().max_retries, lock, status);
+        TSX::Epoch::retire(new Tracked());
+    }
+    reclaim();
+    REQUIRE(Tracked::destroyed == 21);
+}
+
+TEST_CASE("Epoch thread exit TEST", "[epoch]") {
+    Tracked::destroyed = 0;
+    reclaim();
+
+    // a thread exiting while this one is pinned leaves its nodes
+    // to be freed by a later collection
+    {
+        TSX::Epoch::Pin pin;
+        std::thread writer([]() {
+            for (int i = 0; i < 10; i++) TSX::Epoch::retire(new Tracked());
+        });
+        writer.join();
+        reclaim();
+        REQUIRE(Tracked::destroyed == 0);
+    }
+    reclaim();
+    REQUIRE(Tracked::destroyed == 10);
+
+    // with every slot taken, a further thread is refused
+    std::atomic<int> ready(0), refused(0);
+    std::atomic<bool> release(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < TSX::Epoch::MAX_THREADS; i++) {
+        threads.push_back(std::thread([&]() {
+            try {
+                TSX::Epoch::Pin pin;
+                ready++;
+                while (!release) std::this_thread::yield();
+            } catch (const std::length_error &) {
+                refused++;
+                ready++;
+            }
+        }));
+    }
+    while (ready != TSX::Epoch::MAX_THREADS) std::this_thread::yield();
+    release = true;
+    for (std::thread &t : threads) t.join();
+    REQUIRE(refused >= 1);
+
+    // the slots are handed back when the threads exit
+    std::thread again([&]() {
+        TSX::Epoch::Pin pin;
+        TSX::Epoch::retire(new Tracked());
+    });
+    again.join();
+    reclaim();
+    REQUIRE(Tracked::destroyed == 11);
+}
+
+// every thread replaces random slots with fresh nodes in a guard and
+// retires the old ones, reading other slots outside the guard
+void epoch_worker(std::vector<std::atomic<Tracked *> > &slots, TSX::SpinLock &lock, int tid,
+                  std::atomic<long> &bad) {
+    uint64_t rng = tid + 1;
+    for (int i = 0; i < 20000; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        Tracked *fresh = new Tracked();
+
+        TSX::Epoch::Pin pin;
+        Tracked *read = slots[rng % slots.size()].load();
+        {
+            unsigned char status = 0;
+            TSX::EpochGuard guard(TSX::machine_profile().max_retries, lock, status);
+            Tracked *old = slots[(rng >> 20) % slots.size()].load();
+            slots[(rng >> 20) % slots.size()].store(fresh);
+            TSX::Epoch::retire(old);
+        }
+        // still pinned, so the node read before stays alive
+        if (read->check != ALIVE) bad++;
+    }
+}
+
+TEST_CASE("Epoch Concurrent TEST", "[epoch]") {
+    std::vector<std::atomic<Tracked *> > slots(16);
+    for (std::atomic<Tracked *> &s : slots) s.store(new Tracked());
+    TSX::SpinLock lock;
+    std::atomic<long> bad(0);
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(epoch_worker, std::ref(slots), std::ref(lock), i, std::ref(bad));
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(bad.load() == 0);
+    for (std::atomic<Tracked *> &s : slots) delete s.load();
+}
@@ -0,0 +1,98 @@
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXHashMap.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("HashMap TEST", "[hashmap]") {
+    // small initial capacity, so the map resizes many times
+    TSX::HashMap<long, long> map(16);
+    const long N = 10000;
+
+    for (long i = 0; i < N; i++) {
+        REQUIRE(map.insert(i, i * 2));
+    }
+    REQUIRE(map.size() == N);
+    REQUIRE(map.capacity() >= N);
+
+    // duplicates are rejected, insert_or_assign overwrites
+    REQUIRE_FALSE(map.insert(7, 0));
+    REQUIRE_FALSE(map.insert_or_assign(7, 70));
+
+    for (long i = 0; i < N; i += 2) {
+        REQUIRE(map.erase(i));
+    }
+    REQUIRE_FALSE(map.erase(0));
+    REQUIRE(map.size() == N / 2);
+
+    for (long i = 0; i < N; i++) {
+        long value = -1;
+        bool found = map.find(i, value);
+        REQUIRE(found == (i % 2 == 1));
+        if (found) REQUIRE(value == (i == 7 ? 70 : i * 2));
+    }
+
+    // reinsert into the tombstones
+    for (long i = 0; i < N; i += 2) {
+        REQUIRE(map.insert(i, -i));
+    }
+    REQUIRE(map.size() == N);
+}
+
+// every key in one cluster
+struct CollidingHash {
+    std::size_t operator()(long) const { return 0; }
+};
+
+TEST_CASE("HashMap collisions TEST", "[hashmap]") {
+    // at low load a long probe sequence doubles the
+    // table instead of copying it at the same size
+    TSX::HashMap<long, long, CollidingHash> map(1024);
+    const std::size_t initial = map.capacity();
+    const long N = 500;
+    for (long i = 0; i < N; i++) {
+        REQUIRE(map.insert(i, i));
+        if (i % 2) REQUIRE(map.erase(i));
+    }
+    REQUIRE(map.size() == N / 2);
+    REQUIRE(map.capacity() > initial);
+    for (long i = 0; i < N; i++) REQUIRE(map.contains(i) == (i % 2 == 0));
+}
+
+void hashmap_worker(TSX::HashMap<long, long> &map, int tid, long n) {
+    for (long i = tid; i < n; i += THREADS) {
+        map.insert(i, i);
+    }
+    // every thread erases its own multiples of 3
+    for (long i = tid; i < n; i += THREADS) {
+        if (i % 3 == 0) map.erase(i);
+    }
+}
+
+TEST_CASE("HashMap Concurrent TEST", "[hashmap]") {
+    TSX::HashMap<long, long> map(16);
+    const long N = 20000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(hashmap_worker, std::ref(map), i, N);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    long expected = 0;
+    for (long i = 0; i < N; i++) {
+        long value = -1;
+        bool found = map.find(i, value);
+        REQUIRE(found == (i % 3 != 0));
+        if (found) {
+            REQUIRE(value == i);
+            expected++;
+        }
+    }
+    REQUIRE(map.size() == static_cast<std::size_t>(expected));
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXHugeRegion.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("HugeRegion TEST", "[hugeregion]") {
+    TSX::HugeRegion region(1000);
+    REQUIRE(region.capacity() == static_cast<std::size_t>(TSX::HugeRegion::HUGE_PAGE_SIZE));
+    REQUIRE(region.used() == 0);
+
+    char *a = static_cast<char *>(region.allocate(1));
+    char *b = static_cast<char *>(region.allocate(200));
+    REQUIRE(reinterpret_cast<uintptr_t>(a) % TSX::HugeRegion::HUGE_PAGE_SIZE == 0);
+    REQUIRE(b - a == TSX::ALIGNMENT);
+    REQUIRE(region.used() == 3 * TSX::ALIGNMENT);
+
+    // pre-faulted and writable
+    for (std::size_t i = 0; i < 200; i++) b[i] = 1;
+
+    REQUIRE_THROWS_AS(region.allocate(region.capacity()), std::bad_alloc);
+}
+
+TEST_CASE("HugeRegion allocator TEST", "[hugeregion]") {
+    TSX::HugeRegion region(4 * 1024 * 1024);
+    typedef TSX::RegionAllocator<std::pair<const long, long> > Allocator;
+    std::map<long, long, std::less<long>, Allocator> map((std::less<long>()), Allocator(region));
+
+    for (long i = 0; i < 1000; i++) map[i] = i * 3;
+    REQUIRE(map.size() == 1000);
+    REQUIRE(map[999] == 2997);
+    REQUIRE(region.used() >= 1000 * static_cast<std::size_t>(TSX::ALIGNMENT));
+
+    TSX::RegionAllocator<int> ints(region);
+    REQUIRE(ints == Allocator(region));
+    TSX::HugeRegion other(1);
+    REQUIRE(ints != TSX::RegionAllocator<int>(other));
+}
+
+void hugeregion_worker(TSX::HugeRegion &region, long tid, std::vector<long *> &blocks) {
+    for (int i = 0; i < 1000; i++) {
+        long *block = static_cast<long *>(region.allocate(sizeof(long) * 4));
+        for (int j = 0; j < 4; j++) block[j] = tid;
+        blocks.push_back(block);
+    }
+}
+
+TEST_CASE("HugeRegion Concurrent TEST", "[hugeregion]") {
+    TSX::HugeRegion region(THREADS * 1000 * TSX::ALIGNMENT);
+    std::vector<long *> blocks[THREADS];
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(hugeregion_worker, std::ref(region), i, std::ref(blocks[i]));
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    // no block was handed out twice
+    for (long tid = 0; tid < THREADS; tid++) {
+        for (long *block : blocks[tid]) {
+            for (int j = 0; j < 4; j++) REQUIRE(block[j] == tid);
+        }
+    }
+    REQUIRE(region.used() == THREADS * 1000 * static_cast<std::size_t>(TSX::ALIGNMENT));
+}
@@ -0,0 +1,84 @@
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXKCAS.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("KCAS TEST", "[kcas]") {
+    TSX::KCASWord a(4), b(8), c(12);
+    TSX::KCASWord *words[3] = { &a, &b, &c };
+
+    const uintptr_t wrong[3] = { 4, 8, 16 };
+    const uintptr_t expected[3] = { 4, 8, 12 };
+    const uintptr_t desired[3] = { 40, 80, 120 };
+
+    REQUIRE_FALSE(TSX::kcas(words, wrong, desired));
+    REQUIRE(TSX::kcas_read(a) == 4);
+    REQUIRE(TSX::kcas_read(c) == 12);
+
+    REQUIRE(TSX::kcas(words, expected, desired));
+    REQUIRE(TSX::kcas_read(a) == 40);
+    REQUIRE(TSX::kcas_read(b) == 80);
+    REQUIRE(TSX::kcas_read(c) == 120);
+
+    REQUIRE_FALSE(TSX::kcas_software(3, words, expected, desired));
+    REQUIRE(TSX::kcas_software(3, words, desired, expected));
+    REQUIRE(TSX::kcas_read(b) == 8);
+}
+
+// every thread moves units between random words,
+// the total stays the same if every k-CAS is atomic
+template <bool SOFTWARE>
+void kcas_worker(std::vector<TSX::KCASWord> &words, int tid, long ops) {
+    uint64_t rng = tid + 1;
+    long done = 0;
+    while (done < ops) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        std::size_t i = rng % words.size(), j = (rng >> 20) % words.size(), l = (rng >> 40) % words.size();
+        if (i == j || j == l || i == l) continue;
+
+        TSX::KCASWord *addrs[3] = { &words[i], &words[j], &words[l] };
+        uintptr_t expected[3], desired[3];
+        for (int w = 0; w < 3; w++) expected[w] = TSX::kcas_read(*addrs[w]);
+        if (expected[0] < 8) continue;
+        desired[0] = expected[0] - 8;
+        desired[1] = expected[1] + 4;
+        desired[2] = expected[2] + 4;
+
+        bool ok = SOFTWARE ? TSX::kcas_software(3, addrs, expected, desired) : TSX::kcas(addrs, expected, desired);
+        if (ok) done++;
+    }
+}
+
+template <bool SOFTWARE>
+void kcas_concurrent() {
+    const int WORDS = 16;
+    std::vector<TSX::KCASWord> words(WORDS);
+    for (TSX::KCASWord &w : words) w.store(4 * 1000);
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(kcas_worker<SOFTWARE>, std::ref(words), i, 20000);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    uintptr_t total = 0;
+    for (TSX::KCASWord &w : words) {
+        uintptr_t v = TSX::kcas_read(w);
+        REQUIRE((v & 3) == 0);
+        total += v;
+    }
+    REQUIRE(total == 4 * 1000 * WORDS);
+}
+
+TEST_CASE("KCAS Concurrent TEST", "[kcas]") {
+    kcas_concurrent<false>();
+    kcas_concurrent<true>();
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXLRUCache.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("LRUCache TEST", "[lrucache]") {
+    TSX::LRUCache<long, long> cache(3);
+    long value = 0;
+
+    REQUIRE_FALSE(cache.put(1, 10));
+    REQUIRE_FALSE(cache.put(2, 20));
+    REQUIRE_FALSE(cache.put(3, 30));
+    REQUIRE(cache.size() == 3);
+
+    // 1 becomes the most recent, 2 the least
+    REQUIRE(cache.get(1, value));
+    REQUIRE(value == 10);
+    REQUIRE(cache.put(4, 40));
+    REQUIRE_FALSE(cache.contains(2));
+    REQUIRE(cache.contains(1));
+
+    // overwriting promotes too
+    REQUIRE_FALSE(cache.put(3, 31));
+    REQUIRE(cache.put(5, 50));
+    REQUIRE_FALSE(cache.contains(1));
+    REQUIRE(cache.get(3, value));
+    REQUIRE(value == 31);
+
+    REQUIRE(cache.erase(3));
+    REQUIRE_FALSE(cache.erase(3));
+    REQUIRE(cache.size() == 2);
+    REQUIRE_FALSE(cache.put(6, 60));
+    REQUIRE(cache.contains(4));
+    REQUIRE(cache.contains(5));
+    REQUIRE(cache.contains(6));
+}
+
+TEST_CASE("LRUCache sampled promotion TEST", "[lrucache]") {
+    TSX::LRUCache<long, long> cache(100, 4);
+    for (long i = 0; i < 1000; i++) {
+        cache.put(i, i);
+        long value = -1;
+        if (cache.get(i / 2, value)) REQUIRE(value == i / 2);
+    }
+    REQUIRE(cache.size() == 100);
+    // the latest puts are always cached
+    for (long i = 990; i < 1000; i++) REQUIRE(cache.contains(i));
+
+    // hits on one cache do not count towards promotions in another
+    TSX::LRUCache<long, long> a(2, 2), b(2, 2);
+    long value = 0;
+    a.put(1, 1);
+    a.put(2, 2);
+    b.put(1, 1);
+    REQUIRE(b.get(1, value));
+    REQUIRE(a.get(1, value));      // first hit, not promoted
+    a.put(3, 3);
+    REQUIRE_FALSE(a.contains(1));
+    REQUIRE(a.contains(2));
+}
+
+void lrucache_worker(TSX::LRUCache<long, long> &cache, int tid, std::atomic<long> &bad) {
+    for (long i = 0; i < 20000; i++) {
+        long key = (i * 7919 + tid * 31) % 512;
+        long value = -1;
+        if (cache.get(key, value)) {
+            if (value != key * 2) bad++;
+        } else {
+            cache.put(key, key * 2);
+        }
+        if (i % 10 == 0) cache.erase((key + 1) % 512);
+    }
+}
+
+TEST_CASE("LRUCache Concurrent TEST", "[lrucache]") {
+    TSX::LRUCache<long, long> cache(256, 2);
+    std::atomic<long> bad(0);
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(lrucache_worker, std::ref(cache), i, std::ref(bad));
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(bad.load() == 0);
+    REQUIRE(cache.size() <= 256);
+
+    long cached = 0;
+    for (long key = 0; key < 512; key++) {
+        long value = -1;
+        if (cache.get(key, value)) {
+            REQUIRE(value == key * 2);
+            cached++;
+        }
+    }
+    REQUIRE(cached == static_cast<long>(cache.size()));
+}
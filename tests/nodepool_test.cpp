@@ -0,0 +1,145 @@
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXNodePool.hpp"
+#include "../include/TSXProfile.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("NodePool TEST", "[nodepool]") {
+    TSX::NodePool::flush();
+
+    void *a = TSX::NodePool::allocate(24);
+    void *b = TSX::NodePool::allocate(24);
+    REQUIRE(a != b);
+    REQUIRE(reinterpret_cast<uintptr_t>(a) % 32 == 0);
+
+    // freed blocks are handed out again
+    TSX::NodePool::deallocate(b, 24);
+    REQUIRE(TSX::NodePool::allocate(20) == b);
+
+    void *line = TSX::NodePool::allocate(TSX::CACHE_LINE_SIZE);
+    REQUIRE(reinterpret_cast<uintptr_t>(line) % TSX::CACHE_LINE_SIZE == 0);
+
+    TSX::NodePool::reserve(200, 1000);
+    REQUIRE(TSX::NodePool::available(200) >= 1000);
+
+    void *big = TSX::NodePool::allocate(TSX::NodePool::MAX_BLOCK + 1);
+    REQUIRE(big != nullptr);
+
+    TSX::NodePool::deallocate(big, TSX::NodePool::MAX_BLOCK + 1);
+    TSX::NodePool::deallocate(line, TSX::CACHE_LINE_SIZE);
+    TSX::NodePool::deallocate(b, 24);
+    TSX::NodePool::deallocate(a, 24);
+}
+
+TEST_CASE("NodePool guarded TEST", "[nodepool]") {
+    TSX::SpinLock lock;
+    std::vector<long *> nodes;
+
+    // allocations and frees inside guards, with and without a reserve
+    for (int i = 0; i < 100; i++) {
+        if (i == 50) TSX::NodePool::reserve(sizeof(long), 100);
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, lock, status);
+        long *node = static_cast<long *>(TSX::NodePool::allocate(sizeof(long)));
+        *node = i;
+        nodes.push_back(node);
+    }
+    for (int i = 0; i < 100; i++) REQUIRE(*nodes[i] == i);
+
+    const std::size_t before = TSX::NodePool::available(sizeof(long));
+    {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, lock, status);
+        for (long *node : nodes) TSX::NodePool::deallocate(node, sizeof(long));
+    }
+    TSX::NodePool::flush();
+    REQUIRE(TSX::NodePool::available(sizeof(long)) == before + 100);
+}
+
+TEST_CASE("NodePool allocator TEST", "[nodepool]") {
+    std::map<int, int, std::less<int>, TSX::PoolAllocator<std::pair<const int, int> > > map;
+    std::list<int, TSX::PoolAllocator<int> > list;
+    for (int i = 0; i < 1000; i++) {
+        map[i] = i * 2;
+        list.push_back(i);
+    }
+    for (int i = 0; i < 1000; i += 2) map.erase(i);
+
+    REQUIRE(map.size() == 500);
+    REQUIRE(map[501] == 1002);
+    REQUIRE(list.size() == 1000);
+    REQUIRE(list.back() == 999);
+    REQUIRE(TSX::PoolAllocator<int>() == TSX::PoolAllocator<long>());
+}
+
+TEST_CASE("NodePool producer consumer TEST", "[nodepool]") {
+    // blocks freed by another thread go back through the depot
+    // instead of piling up in the freeing thread's cache
+    const std::size_t size = 512;
+    const std::size_t per_chunk = TSX::NodePool::CHUNK_BYTES / size;
+    std::vector<void *> blocks;
+    std::size_t consumer_available = 0;
+    for (int round = 0; round < 20; round++) {
+        std::thread producer([&]() {
+            for (std::size_t i = 0; i < per_chunk; i++) blocks.push_back(TSX::NodePool::allocate(size));
+        });
+        producer.join();
+        for (void *p : blocks) TSX::NodePool::deallocate(p, size);
+        blocks.clear();
+        consumer_available = TSX::NodePool::available(size);
+        REQUIRE(consumer_available <= 2 * per_chunk);
+    }
+    REQUIRE(consumer_available > 0);
+}
+
+// every thread frees the blocks of the thread before it
+void nodepool_worker(std::vector<std::atomic<long *> > &handoff, TSX::SpinLock &lock, int tid,
+                     std::atomic<long> &bad) {
+    const int prev = (tid + THREADS - 1) % THREADS;
+    for (long i = 0; i < 20000; i++) {
+        long *node;
+        {
+            unsigned char status = 0;
+            TSX::TSXGuard guard(TSX::machine_profile().max_retries, lock, status);
+            node = static_cast<long *>(TSX::NodePool::allocate(sizeof(long) * 4));
+            node[0] = tid;
+            node[3] = i;
+        }
+        node = handoff[tid].exchange(node);
+        if (node && node[0] != tid) bad++;
+
+        long *other = handoff[prev].exchange(nullptr);
+        if (other) {
+            if (other[0] != prev) bad++;
+            other[0] = -1;
+            TSX::NodePool::deallocate(other, sizeof(long) * 4);
+        }
+        if (node) TSX::NodePool::deallocate(node, sizeof(long) * 4);
+    }
+    TSX::NodePool::deallocate(handoff[tid].exchange(nullptr), sizeof(long) * 4);
+}
+
+TEST_CASE("NodePool Concurrent TEST", "[nodepool]") {
+    TSX::SpinLock lock;
+    std::vector<std::atomic<long *> > handoff(THREADS);
+    for (std::atomic<long *> &h : handoff) h.store(nullptr);
+    std::atomic<long> bad(0);
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(nodepool_worker, std::ref(handoff), std::ref(lock), i, std::ref(bad));
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(bad.load() == 0);
+}
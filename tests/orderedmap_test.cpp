@@ -0,0 +1,82 @@
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXOrderedMap.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("OrderedMap TEST", "[orderedmap]") {
+    TSX::OrderedMap<long, long> map;
+    const long N = 5000;
+
+    // a permutation of [0, N)
+    for (long i = 0; i < N; i++) {
+        long key = (i * 7919) % N;
+        REQUIRE(map.insert(key, key * 2));
+    }
+    REQUIRE(map.verify());
+    REQUIRE(map.size() == N);
+    REQUIRE_FALSE(map.insert(10, 0));
+    REQUIRE_FALSE(map.insert_or_assign(10, 100));
+
+    long value = 0;
+    REQUIRE(map.find(10, value));
+    REQUIRE(value == 100);
+
+    // range visits [lo, hi] in order, across several chunks
+    std::vector<long> keys;
+    std::size_t visited = map.range(100, 199, [&](long k, long) { keys.push_back(k); });
+    REQUIRE(visited == 100);
+    REQUIRE(keys.size() == 100);
+    for (long i = 0; i < 100; i++) REQUIRE(keys[i] == 100 + i);
+
+    for (long i = 0; i < N; i += 3) {
+        REQUIRE(map.erase(i));
+    }
+    REQUIRE_FALSE(map.erase(0));
+    REQUIRE(map.verify());
+
+    for (long i = 0; i < N; i++) {
+        REQUIRE(map.contains(i) == (i % 3 != 0));
+    }
+
+    for (long i = 0; i < N; i++) map.erase(i);
+    REQUIRE(map.verify());
+    REQUIRE(map.size() == 0);
+    REQUIRE(map.range(0, N, [](long, long) {}) == 0);
+}
+
+void orderedmap_worker(TSX::OrderedMap<long, long> &map, int tid, long n) {
+    for (long i = tid; i < n; i += THREADS) {
+        map.insert(i, i);
+    }
+    for (long i = tid; i < n; i += THREADS) {
+        if (i % 2 == 0) map.erase(i);
+    }
+}
+
+TEST_CASE("OrderedMap Concurrent TEST", "[orderedmap]") {
+    TSX::OrderedMap<long, long> map;
+    const long N = 20000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(orderedmap_worker, std::ref(map), i, N);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(map.verify());
+    REQUIRE(map.size() == N / 2);
+
+    long expected = 1;
+    map.range(0, N, [&](long k, long v) {
+        REQUIRE(k == expected);
+        REQUIRE(v == expected);
+        expected += 2;
+    });
+    REQUIRE(expected == N + 1);
+}
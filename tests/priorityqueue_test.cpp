@@ -0,0 +1,69 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXPriorityQueue.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("PriorityQueue TEST", "[priorityqueue]") {
+    // one heap, exact order, growing from a capacity of 4
+    TSX::PriorityQueue<long, long> exact(1, 4);
+    const long N = 5000;
+
+    for (long i = 0; i < N; i++) {
+        long key = (i * 7919) % N;
+        exact.push(key, key * 2);
+    }
+    REQUIRE(exact.size() == N);
+
+    long key = -1, value = -1;
+    for (long i = 0; i < N; i++) {
+        REQUIRE(exact.pop(key, value));
+        REQUIRE(key == i);
+        REQUIRE(value == 2 * i);
+    }
+    REQUIRE_FALSE(exact.pop(key, value));
+
+    // several heaps, every entry comes out once
+    TSX::PriorityQueue<long, long> relaxed(8, 4);
+    for (long i = 0; i < N; i++) relaxed.push(i, i);
+    std::vector<bool> seen(N, false);
+    while (relaxed.pop(key, value)) {
+        REQUIRE_FALSE(seen[key]);
+        seen[key] = true;
+    }
+    for (long i = 0; i < N; i++) REQUIRE(seen[i]);
+    REQUIRE(relaxed.empty());
+}
+
+TEST_CASE("PriorityQueue Concurrent TEST", "[priorityqueue]") {
+    TSX::PriorityQueue<long, long> queue(2 * THREADS, 16);
+    const long N = 40000;
+    std::atomic<long> popped(0), sum(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.push_back(std::thread([&, t]() {
+            long key, value;
+            for (long i = t; i < N; i += THREADS) {
+                queue.push(i, i);
+                if (i % 3 == 0 && queue.pop(key, value)) {
+                    sum += value;
+                    popped++;
+                }
+            }
+        }));
+    }
+    for (std::thread &t : threads) t.join();
+
+    long key, value;
+    while (queue.pop(key, value)) {
+        sum += value;
+        popped++;
+    }
+    REQUIRE(popped.load() == N);
+    REQUIRE(sum.load() == N * (N - 1) / 2);
+}
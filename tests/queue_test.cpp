@@ -0,0 +1,82 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXBoundedQueue.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("BoundedQueue TEST", "[queue]") {
+    TSX::BoundedQueue<long> queue(100);
+    REQUIRE(queue.capacity() == 128);
+    REQUIRE(queue.empty());
+
+    long value = 0;
+    REQUIRE_FALSE(queue.dequeue(value));
+
+    // wrap around the ring a few times
+    long next_in = 0, next_out = 0;
+    for (int round = 0; round < 10; round++) {
+        while (queue.enqueue(next_in)) next_in++;
+        REQUIRE(queue.size() == 128);
+        for (int i = 0; i < 100; i++) {
+            REQUIRE(queue.dequeue(value));
+            REQUIRE(value == next_out++);
+        }
+    }
+
+    std::vector<long> items(300);
+    for (long &item : items) item = next_in++;
+    REQUIRE(queue.enqueue_bulk(items.data(), items.size()) == 100);
+
+    std::vector<long> out(300);
+    REQUIRE(queue.dequeue_bulk(out.data(), out.size()) == 128);
+    for (int i = 0; i < 128; i++) {
+        REQUIRE(out[i] == next_out++);
+    }
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("BoundedQueue Concurrent TEST", "[queue]") {
+    TSX::BoundedQueue<long> queue(64);
+    const long N = 50000;
+    std::atomic<long> consumed(0), sum(0), out_of_order(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < THREADS / 2; p++) {
+        threads.push_back(std::thread([&queue, p]() {
+            long batch[8];
+            for (long i = p; i < N; ) {
+                int n = 0;
+                for (; n < 8 && i < N; i += THREADS / 2) batch[n++] = i;
+                for (int done = 0; done < n; ) {
+                    done += queue.enqueue_bulk(batch + done, n - done);
+                }
+            }
+        }));
+    }
+    for (int c = 0; c < THREADS / 2; c++) {
+        threads.push_back(std::thread([&]() {
+            long last[THREADS / 2];
+            for (long &l : last) l = -1;
+            while (consumed.load() < N) {
+                long value = 0;
+                if (!queue.dequeue(value)) continue;
+                // items of one producer come out in order
+                long producer = value % (THREADS / 2);
+                if (value < last[producer]) out_of_order++;
+                last[producer] = value;
+                sum += value;
+                consumed++;
+            }
+        }));
+    }
+    for (std::thread &t : threads) t.join();
+
+    REQUIRE(out_of_order.load() == 0);
+    REQUIRE(consumed.load() == N);
+    REQUIRE(sum.load() == N * (N - 1) / 2);
+    REQUIRE(queue.empty());
+}
@@ -0,0 +1,116 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXRadixTree.hpp"
+
+static const int THREADS = 4;
+
+// long shared prefixes exercise the prefixes
+// longer than the bytes stored in a node
+static std::string radix_key(long i) {
+    return (i % 2 ? "user:profile:settings:" : "u:") + std::to_string(i);
+}
+
+TEST_CASE("RadixTree TEST", "[radixtree]") {
+    TSX::RadixTree<long> tree;
+    const long N = 5000;
+
+    for (long i = 0; i < N; i++) {
+        long key = (i * 7919) % N;
+        REQUIRE(tree.insert(radix_key(key), key * 2));
+    }
+    REQUIRE_FALSE(tree.insert(radix_key(10), 0));
+    REQUIRE(tree.size() == N);
+
+    long value = 0;
+    REQUIRE(tree.find(radix_key(10), value));
+    REQUIRE(value == 20);
+    REQUIRE_FALSE(tree.contains("u:"));
+    REQUIRE_FALSE(tree.contains("u:100000"));
+
+    REQUIRE_FALSE(tree.insert_or_assign(radix_key(10), 11));
+    REQUIRE(tree.find(radix_key(10), value));
+    REQUIRE(value == 11);
+
+    // keys that are prefixes of each other
+    REQUIRE(tree.insert("a", 1));
+    REQUIRE(tree.insert("ab", 2));
+    REQUIRE(tree.insert("abc", 3));
+    REQUIRE(tree.find("ab", value));
+    REQUIRE(value == 2);
+    REQUIRE(tree.erase("ab"));
+    REQUIRE(tree.contains("a"));
+    REQUIRE(tree.contains("abc"));
+    REQUIRE_FALSE(tree.contains("ab"));
+
+    for (long i = 0; i < N; i += 3) {
+        REQUIRE(tree.erase(radix_key(i)));
+    }
+    REQUIRE_FALSE(tree.erase(radix_key(0)));
+
+    for (long i = 0; i < N; i++) {
+        REQUIRE(tree.contains(radix_key(i)) == (i % 3 != 0));
+    }
+
+    // shrinking all the way back to an empty tree
+    for (long i = 0; i < N; i++) {
+        tree.erase(radix_key(i));
+    }
+    tree.erase("a");
+    tree.erase("abc");
+    REQUIRE(tree.size() == 0);
+    REQUIRE(tree.insert("a", 1));
+    REQUIRE(tree.contains("a"));
+}
+
+TEST_CASE("RadixTree node sizes TEST", "[radixtree]") {
+    TSX::RadixTree<long> tree;
+
+    // one inner node grows through Node4, 16, 48 and 256 and shrinks back
+    for (int b = 1; b < 256; b++) {
+        REQUIRE(tree.insert(std::string("k") + static_cast<char>(b), b));
+    }
+    REQUIRE(tree.size() == 255);
+    for (int b = 1; b < 256; b++) {
+        long value = 0;
+        REQUIRE(tree.find(std::string("k") + static_cast<char>(b), value));
+        REQUIRE(value == b);
+    }
+    for (int b = 255; b > 1; b--) {
+        REQUIRE(tree.erase(std::string("k") + static_cast<char>(b)));
+        REQUIRE(tree.contains(std::string("k") + static_cast<char>(b - 1)));
+    }
+    REQUIRE(tree.size() == 1);
+}
+
+void radixtree_worker(TSX::RadixTree<long> &tree, int tid, long n) {
+    for (long i = tid; i < n; i += THREADS) {
+        tree.insert(radix_key(i), i);
+    }
+    for (long i = tid; i < n; i += THREADS) {
+        if (i % 2 == 0) tree.erase(radix_key(i));
+    }
+}
+
+TEST_CASE("RadixTree Concurrent TEST", "[radixtree]") {
+    TSX::RadixTree<long> tree;
+    const long N = 20000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(radixtree_worker, std::ref(tree), i, N);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(tree.size() == N / 2);
+    for (long i = 0; i < N; i++) {
+        long value = -1;
+        REQUIRE(tree.find(radix_key(i), value) == (i % 2 == 1));
+        if (i % 2 == 1) REQUIRE(value == i);
+    }
+}
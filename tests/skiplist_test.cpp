@@ -0,0 +1,87 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXSkipList.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("SkipList TEST", "[skiplist]") {
+    TSX::SkipList<long, long> list;
+    const long N = 5000;
+
+    for (long i = 0; i < N; i++) {
+        long key = (i * 7919) % N;
+        REQUIRE(list.insert(key, key * 2));
+    }
+    REQUIRE_FALSE(list.insert(10, 0));
+
+    long value = 0;
+    REQUIRE(list.find(10, value));
+    REQUIRE(value == 20);
+
+    for (long i = 0; i < N; i += 3) {
+        REQUIRE(list.erase(i));
+    }
+    REQUIRE_FALSE(list.erase(0));
+
+    long expected = 1;
+    list.for_each([&](long k, long v) {
+        REQUIRE(k == expected);
+        REQUIRE(v == 2 * k);
+        expected += expected % 3 == 1 ? 1 : 2;
+    });
+    REQUIRE(expected >= N);
+
+    for (long i = 0; i < N; i++) {
+        REQUIRE(list.contains(i) == (i % 3 != 0));
+    }
+}
+
+void skiplist_writer(TSX::SkipList<long, long> &list, int tid, long n) {
+    for (long i = tid; i < n; i += THREADS) {
+        list.insert(i, i);
+    }
+    for (long i = tid; i < n; i += THREADS) {
+        if (i % 2 == 0) list.erase(i);
+    }
+}
+
+TEST_CASE("SkipList Concurrent TEST", "[skiplist]") {
+    TSX::SkipList<long, long> list;
+    const long N = 20000;
+    std::atomic<bool> done(false);
+    std::atomic<long> bad_reads(0);
+
+    // readers run unsynchronized next to the writers
+    std::thread reader([&]() {
+        while (!done.load()) {
+            for (long i = 0; i < N; i += 97) {
+                long value = -1;
+                if (list.find(i, value) && value != i) bad_reads++;
+            }
+        }
+    });
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(skiplist_writer, std::ref(list), i, N);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+    done.store(true);
+    reader.join();
+
+    REQUIRE(bad_reads.load() == 0);
+
+    long expected = 1, count = 0;
+    list.for_each([&](long k, long) {
+        REQUIRE(k == expected);
+        expected += 2;
+        count++;
+    });
+    REQUIRE(count == N / 2);
+}
@@ -0,0 +1,98 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/catch.hpp"
+
+#include "../include/TSXThreadPool.hpp"
+
+static const int THREADS = 4;
+
+TEST_CASE("WorkStealingDeque TEST", "[threadpool]") {
+    TSX::WorkStealingDeque<long> deque(16);
+
+    for (long i = 0; i < 16; i++) {
+        REQUIRE(deque.push(i));
+    }
+    REQUIRE_FALSE(deque.push(16));
+
+    // thieves take the oldest items, the owner the newest
+    long value = -1;
+    REQUIRE(deque.steal(value));
+    REQUIRE(value == 0);
+    REQUIRE(deque.pop(value));
+    REQUIRE(value == 15);
+
+    std::vector<bool> seen(16, false);
+    seen[0] = seen[15] = true;
+    while (deque.pop(value)) {
+        REQUIRE_FALSE(seen[value]);
+        seen[value] = true;
+    }
+    REQUIRE_FALSE(deque.steal(value));
+    for (bool s : seen) REQUIRE(s);
+}
+
+TEST_CASE("WorkStealingDeque Concurrent TEST", "[threadpool]") {
+    TSX::WorkStealingDeque<long> deque(256);
+    const long N = 100000;
+    std::vector<std::atomic<int> > taken(N);
+    for (std::atomic<int> &t : taken) t.store(0);
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < THREADS - 1; i++) {
+        thieves.push_back(std::thread([&]() {
+            long value;
+            while (!done.load()) {
+                if (deque.steal(value)) taken[value]++;
+            }
+        }));
+    }
+
+    // the owner pushes everything and pops every other time
+    long value;
+    for (long i = 0; i < N; i++) {
+        while (!deque.push(i)) {
+            if (deque.pop(value)) taken[value]++;
+        }
+        if (i % 2 && deque.pop(value)) taken[value]++;
+    }
+    while (deque.pop(value)) taken[value]++;
+    done.store(true);
+    for (std::thread &t : thieves) t.join();
+
+    long missing = 0, twice = 0;
+    for (std::atomic<int> &t : taken) {
+        if (t.load() == 0) missing++;
+        if (t.load() > 1) twice++;
+    }
+    REQUIRE(missing == 0);
+    REQUIRE(twice == 0);
+}
+
+static void spawn(TSX::ThreadPool &pool, std::atomic<long> &leaves, int depth) {
+    if (depth == 0) {
+        leaves++;
+        return;
+    }
+    pool.submit([&pool, &leaves, depth]() { spawn(pool, leaves, depth - 1); });
+    pool.submit([&pool, &leaves, depth]() { spawn(pool, leaves, depth - 1); });
+}
+
+TEST_CASE("ThreadPool TEST", "[threadpool]") {
+    TSX::ThreadPool pool(THREADS, 64);
+    std::atomic<long> leaves(0);
+
+    // tasks spawning tasks, enough to overflow the deques
+    spawn(pool, leaves, 14);
+    pool.wait();
+    REQUIRE(leaves.load() == 1 << 14);
+
+    std::atomic<long> sum(0);
+    for (long i = 1; i <= 1000; i++) {
+        pool.submit([&sum, i]() { sum += i; });
+    }
+    pool.wait();
+    REQUIRE(sum.load() == 500500);
+}
@@ -1,6 +1,8 @@
 
 #include <chrono>
+#include <cstdio>
 #include <sstream>
+#include <stdexcept>
 #include <iostream>
 #include <ctime>
 #include <thread>
@@ -11,6 +13,8 @@
 
 #include "../include/TSXGuard.hpp"
 
+#include "../include/TSXProfile.hpp"
+
 #include "../include/rtm.h"
 
 static const int THREADS = 4;
@@ -88,6 +92,366 @@ void transactional_increment(bool &noEntryFlag, int *data, TSX::SpinLock &spin_l
 }
 
 
+struct PaddedCounter {
+    TSX::PaddedSpinLock lock;
+    long count;
+};
+
+TSX_ASSERT_SEPARATE_LINES(PaddedCounter, lock, count);
+
+TEST_CASE("Padding TEST", "[lock]") {
+    REQUIRE(sizeof(TSX::Padded<char>) == TSX::ALIGNMENT);
+    REQUIRE(alignof(TSX::CacheAligned<long>) == TSX::CACHE_LINE_SIZE);
+
+    // aligned: exact lines
+    REQUIRE(TSX::shares_cache_line(64, 0, 1, 63, 8));
+    REQUIRE_FALSE(TSX::shares_cache_line(64, 0, 1, 64, 8));
+    REQUIRE_FALSE(TSX::shares_cache_line(128, 128, 8, 0, 64));
+    // unaligned: anything closer than a line
+    REQUIRE(TSX::shares_cache_line(8, 0, 1, 63, 8));
+    REQUIRE_FALSE(TSX::shares_cache_line(8, 0, 1, 64, 8));
+
+    TSX::Padded<std::atomic<long> > *counters = new TSX::Padded<std::atomic<long> >[4];
+    REQUIRE(reinterpret_cast<uintptr_t>(counters) % TSX::ALIGNMENT == 0);
+    REQUIRE(reinterpret_cast<char *>(&counters[1]) - reinterpret_cast<char *>(&counters[0]) == TSX::ALIGNMENT);
+    delete[] counters;
+
+    PaddedCounter counter;
+    counter.count = 0;
+    REQUIRE(reinterpret_cast<uintptr_t>(&counter.count) - reinterpret_cast<uintptr_t>(&counter.lock) == TSX::ALIGNMENT);
+    unsigned char status = 0;
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, counter.lock, status);
+        counter.count++;
+    }
+    REQUIRE(counter.count == 1);
+}
+
+TEST_CASE("Prefetch TEST", "[tsx]") {
+    TSX::SpinLock spin_lock;
+    unsigned char status = 0;
+    long a = 0, b = 0;
+    const void *addrs[2] = { &a, &b };
+
+    int warm_ups = 0;
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status,
+                            [&]() { warm_ups++; });
+    }
+    REQUIRE(warm_ups >= 1);
+    REQUIRE(warm_ups <= TSX::machine_profile().max_retries);
+
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status, TSX::Prefetch(addrs));
+        a++;
+        b += 2;
+    }
+    TSX::TSXStats stats;
+    {
+        TSX::TSXGuardWithStats guard(TSX::machine_profile().max_retries, spin_lock, status, stats,
+                                     TSX::Prefetch(addrs, 2, false));
+        a++;
+    }
+    REQUIRE(a == 2);
+    REQUIRE(b == 2);
+    REQUIRE(!spin_lock.isLocked());
+}
+
+TEST_CASE("Prefault TEST", "[tsx]") {
+    const long page = sysconf(_SC_PAGESIZE);
+    const int PAGES = 8;
+    void *mem = mmap(nullptr, PAGES * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mem != MAP_FAILED);
+    char *bytes = static_cast<char *>(mem);
+
+    unsigned char resident[PAGES];
+    TSX::prefault(bytes + page / 2, 3 * page);
+    REQUIRE(mincore(mem, PAGES * page, resident) == 0);
+    for (int i = 0; i < 4; i++) REQUIRE((resident[i] & 1) == 1);
+
+    TSX::SpinLock spin_lock;
+    TSX::TSXStats stats;
+    unsigned char status = 0;
+    {
+        TSX::PrefaultScope scope(mem, PAGES * page);
+        TSX::TSXGuardWithStats guard(100, spin_lock, status, stats);
+        for (int i = 0; i < PAGES; i++) bytes[i * page] = i + 1;
+    }
+    for (int i = 0; i < PAGES; i++) REQUIRE(bytes[i * page] == i + 1);
+    REQUIRE(stats.tx_commits + stats.tx_lacqs == 1);
+    REQUIRE(stats.tx_aborts_per_reason[TSX::TX_ABORT_REST] <= 2 * TSX::PAGE_FAULT_ABORTS);
+
+    // with nothing registered the guard keeps all of its retries
+    TSX::TSXStats plain;
+    {
+        TSX::TSXGuardWithStats guard(10, spin_lock, status, plain);
+        bytes[0]++;
+    }
+    REQUIRE((plain.tx_commits == 1 || plain.tx_aborts == 10));
+
+    munmap(mem, PAGES * page);
+}
+
+// transfer: a composable function with a guard of its own
+void transfer(TSX::SpinLock &lock, long &from, long &to, long amount) {
+    unsigned char status = 0;
+    TSX::TSXGuard guard(TSX::machine_profile().max_retries, lock, status);
+    from -= amount;
+    to += amount;
+}
+
+TEST_CASE("Nested guard TEST", "[tsx]") {
+    TSX::SpinLock outer_lock, inner_lock;
+    long a = 100, b = 0, c = 0;
+    unsigned char status = 0;
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, outer_lock, status);
+        transfer(outer_lock, a, b, 10);
+        {
+            TSX::TSXStats stats;
+            TSX::TSXGuardWithStats nested(TSX::machine_profile().max_retries, outer_lock, status, stats);
+            transfer(inner_lock, b, c, 5);
+            REQUIRE(stats.tx_starts == 0);
+            REQUIRE(stats.tx_lacqs == 0);
+        }
+        transfer(outer_lock, a, c, 1);
+    }
+    REQUIRE(a == 89);
+    REQUIRE(b == 5);
+    REQUIRE(c == 6);
+    REQUIRE_FALSE(outer_lock.isLocked());
+    REQUIRE_FALSE(inner_lock.isLocked());
+    REQUIRE(TSX::innermost_guard() == nullptr);
+}
+
+// moves units between accounts in nested guards on two locks
+void nested_worker(TSX::SpinLock &lock, TSX::SpinLock &other_lock, std::vector<long> &accounts, int tid) {
+    for (int i = 0; i < 20000; i++) {
+        std::size_t x = (i * 7 + tid) % accounts.size(), y = (i * 13 + tid * 3 + 1) % accounts.size();
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, lock, status);
+        transfer(lock, accounts[x], accounts[y], 1);
+        transfer(other_lock, accounts[y], accounts[x], 2);
+    }
+}
+
+TEST_CASE("Nested guard Concurrent TEST", "[tsx]") {
+    TSX::SpinLock lock, other_lock;
+    std::vector<long> accounts(16, 1000);
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(nested_worker, std::ref(lock), std::ref(other_lock), std::ref(accounts), i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    long total = 0;
+    for (long v : accounts) total += v;
+    REQUIRE(total == 16 * 1000);
+}
+
+TEST_CASE("Wait until TEST", "[tsx]") {
+    TSX::SpinLock spin_lock;
+    long items = 0;
+    unsigned char status = 0;
+
+    std::thread consumer([&]() {
+        unsigned char consumer_status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, consumer_status);
+        guard.wait_until([&]() { return items >= 3; });
+        items -= 3;
+    });
+
+    for (int i = 0; i < 3; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        items++;
+    }
+    consumer.join();
+
+    REQUIRE(items == 0);
+    REQUIRE_FALSE(spin_lock.isLocked());
+    REQUIRE(TSX::wait_word(spin_lock).waiters.load() == 0);
+
+    TSX::TSXStats stats;
+    {
+        TSX::TSXGuardWithStats guard(TSX::machine_profile().max_retries, spin_lock, status, stats);
+        guard.wait_until([&]() { return items == 0; });
+    }
+
+    // a nested guard on the lock wakes its waiters as well
+    TSX::SpinLock other_lock;
+    std::thread nested_consumer([&]() {
+        unsigned char consumer_status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, consumer_status);
+        guard.wait_until([&]() { return items > 0; });
+        items--;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, other_lock, status);
+        TSX::TSXGuard nested(TSX::machine_profile().max_retries, spin_lock, status);
+        items++;
+    }
+    nested_consumer.join();
+    REQUIRE(items == 0);
+    REQUIRE(TSX::joined_wait_words() == 0);
+}
+
+// consumers take one item at a time, waiting
+// in the guard while there is none
+void wait_consumer(TSX::SpinLock &spin_lock, long &items, long &taken, int count) {
+    for (int i = 0; i < count; i++) {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        guard.wait_until([&]() { return items > 0; });
+        items--;
+        taken++;
+    }
+}
+
+void wait_producer(TSX::SpinLock &spin_lock, long &items, int count) {
+    for (int i = 0; i < count; i++) {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        items++;
+    }
+}
+
+TEST_CASE("Wait until Concurrent TEST", "[tsx]") {
+    TSX::SpinLock spin_lock;
+    long items = 0, taken = 0;
+    const int COUNT = 5000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        if (i % 2 == 0) {
+            threads[i] = std::thread(wait_consumer, std::ref(spin_lock), std::ref(items), std::ref(taken), COUNT);
+        } else {
+            threads[i] = std::thread(wait_producer, std::ref(spin_lock), std::ref(items), COUNT);
+        }
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(items == 0);
+    REQUIRE(taken == (THREADS / 2) * COUNT);
+}
+
+void too_many_actions(TSX::SpinLock &spin_lock, int &value) {
+    unsigned char status = 0;
+    TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+    for (int i = 0; i <= TSX::MAX_GUARD_ACTIONS; i++) guard.on_commit([&value]() { value++; });
+}
+
+TEST_CASE("Guard actions TEST", "[tsx]") {
+    TSX::SpinLock spin_lock;
+    unsigned char status = 0;
+    int value = 0, committed = 0, compensated = 0;
+    int order[2] = {0, 0};
+    int next = 0;
+
+    {
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        value++;
+        guard.on_commit([&committed]() { committed++; });
+        guard.on_commit([&order, &next]() { order[next++] = 1; });
+        guard.on_commit([&order, &next]() { order[next++] = 2; });
+        guard.on_abort([&compensated]() { compensated++; });
+    }
+    REQUIRE(value == 1);
+    REQUIRE(committed == 1);
+    REQUIRE(order[0] == 1);
+    REQUIRE(order[1] == 2);
+    REQUIRE(compensated == 0);
+    REQUIRE(TSX::guard_actions().count == 0);
+
+    // actions of a nested guard wait for the outermost one
+    int committed_inside = -1;
+    {
+        TSX::TSXGuard outer(TSX::machine_profile().max_retries, spin_lock, status);
+        {
+            TSX::TSXGuard inner(TSX::machine_profile().max_retries, spin_lock, status);
+            inner.on_commit([&committed]() { committed++; });
+        }
+        committed_inside = committed;
+    }
+    REQUIRE(committed_inside == 1);
+    REQUIRE(committed == 2);
+
+    // abandoned under the lock: compensated and unlocked. A
+    // transaction drops its actions when it aborts.
+    bool under_lock = false;
+    {
+        TSX::TSXStats stats;
+        TSX::TSXGuardWithStats guard(TSX::machine_profile().max_retries, spin_lock, status, stats);
+        if (status == 0) {
+            under_lock = !_xtest();
+            guard.on_commit([&committed]() { committed++; });
+            guard.on_abort([&compensated]() { compensated++; });
+            guard.abort_to_retry<3>();
+        }
+    }
+    REQUIRE(committed == 2);
+    REQUIRE(compensated == (under_lock ? 1 : 0));
+    REQUIRE_FALSE(spin_lock.isLocked());
+
+    // so is the outermost section when a nested guard abandons it
+    const int compensated_before = compensated;
+    unsigned char nested_status = 0;
+    under_lock = false;
+    {
+        TSX::TSXGuard outer(TSX::machine_profile().max_retries, spin_lock, nested_status);
+        if (nested_status == 0) {
+            under_lock = !_xtest();
+            outer.on_commit([&committed]() { committed++; });
+            TSX::TSXStats stats;
+            TSX::TSXGuardWithStats inner(TSX::machine_profile().max_retries, spin_lock, nested_status, stats);
+            inner.on_abort([&compensated]() { compensated++; });
+            inner.abort_to_retry<3>();
+        }
+    }
+    REQUIRE(committed == 2);
+    REQUIRE(compensated == compensated_before + (under_lock ? 1 : 0));
+    REQUIRE_FALSE(spin_lock.isLocked());
+    REQUIRE(TSX::guard_actions().count == 0);
+
+    REQUIRE_THROWS_AS(too_many_actions(spin_lock, value), std::length_error);
+    REQUIRE_FALSE(spin_lock.isLocked());
+    REQUIRE(TSX::guard_actions().count == 0);
+}
+
+// every committed section runs its action exactly once
+void actions_worker(TSX::SpinLock &spin_lock, long &shared, long &actions, int count) {
+    for (int i = 0; i < count; i++) {
+        unsigned char status = 0;
+        TSX::TSXGuard guard(TSX::machine_profile().max_retries, spin_lock, status);
+        shared++;
+        guard.on_commit([&actions]() { actions++; });
+    }
+}
+
+TEST_CASE("Guard actions Concurrent TEST", "[tsx]") {
+    TSX::SpinLock spin_lock;
+    long shared = 0;
+    long actions[THREADS] = {0};
+    const int COUNT = 10000;
+
+    std::thread threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        threads[i] = std::thread(actions_worker, std::ref(spin_lock), std::ref(shared), std::ref(actions[i]), COUNT);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        threads[i].join();
+    }
+
+    REQUIRE(shared == THREADS * COUNT);
+    for (int i = 0; i < THREADS; i++) REQUIRE(actions[i] == COUNT);
+}
+
 TEST_CASE("TSX RTM TEST", "[tsx]") {
     std::cout << "Testing RTM Implementation" << std::endl;
     TSX::SpinLock spin_lock;
@@ -171,3 +535,29 @@ TEST_CASE("TSX RTM ABORT TEST", "[tsx]") {
 
 
 
+
+TEST_CASE("MachineProfile TEST", "[profile]") {
+    TSX::MachineProfile profile;
+    profile.rtm_usable = false;
+    profile.read_capacity = 4096;
+    profile.write_capacity = 512;
+    profile.max_cycles = 1 << 20;
+    profile.max_retries = 1;
+
+    const char *path = "tsx_profile_test.txt";
+    REQUIRE(profile.save(path));
+
+    TSX::MachineProfile loaded;
+    REQUIRE(loaded.load(path));
+    std::remove(path);
+
+    REQUIRE(loaded.rtm_usable == false);
+    REQUIRE(loaded.read_capacity == 4096);
+    REQUIRE(loaded.write_capacity == 512);
+    REQUIRE(loaded.max_cycles == (1 << 20));
+    REQUIRE(loaded.max_retries == 1);
+
+    TSX::MachineProfile missing;
+    REQUIRE_FALSE(missing.load("no_such_profile.txt"));
+    REQUIRE(missing.max_retries == TSX::MachineProfile().max_retries);
+}